@@ -582,6 +582,35 @@ void BitmapBuffer::invertRect(coord_t x, coord_t y, coord_t w, coord_t h, LcdFla
   }
 }
 
+void BitmapBuffer::moveRect(coord_t x, coord_t y, coord_t w, coord_t h, coord_t dx, coord_t dy)
+{
+  APPLY_OFFSET();
+
+  // clip the destination, the source follows
+  coord_t dstx = x + dx;
+  coord_t dsty = y + dy;
+  if (!applyClippingRect(dstx, dsty, w, h))
+    return;
+
+  x = dstx - dx;
+  y = dsty - dy;
+  if (x < 0 || y < 0 || x + w > _width || y + h > _height)
+    return;
+
+  // rows are processed in the direction which doesn't overwrite the source
+  // before it is moved, memmove handles the overlap inside a row
+  for (coord_t i = 0; i < h; i++) {
+    coord_t row = (dy > 0 ? h - 1 - i : i);
+    pixel_t * src = getPixelPtrAbs(x, y + row);
+    pixel_t * dst = getPixelPtrAbs(dstx, dsty + row);
+#if defined(LCD_VERTICAL_INVERT)
+    src -= w - 1;
+    dst -= w - 1;
+#endif
+    memmove(dst, src, w * sizeof(pixel_t));
+  }
+}
+
 /*
   Notice: BitmapBuffer::drawFilledTriangle use the implementation
           made for the Adafruit GFX library, which is licensed under BSD
@@ -280,6 +280,9 @@ class BitmapBuffer: public BitmapBufferBase<pixel_t>
 
     void invertRect(coord_t x, coord_t y, coord_t w, coord_t h, LcdFlags flags = 0);
 
+    // moves the pixels of a rect inside the buffer, source and destination may overlap
+    void moveRect(coord_t x, coord_t y, coord_t w, coord_t h, coord_t dx, coord_t dy);
+
     void drawFilledTriangle(coord_t x1, coord_t y1, coord_t x2, coord_t y2, coord_t x3, coord_t y3, LcdFlags flags = 0, uint8_t opacity = 0);
 
     void drawCircle(coord_t x, coord_t y, coord_t radius, LcdFlags flags = 0);
@@ -42,6 +42,12 @@ class BufferedWindow: public T
     BitmapBuffer * bitmap = nullptr;
     bool paintUpdateNeeded = false;
     virtual void paintUpdate(BitmapBuffer * dc) = 0;
+
+    // the buffer has to be updated when a child changes
+    bool catchesChildrenInvalidations() const override
+    {
+      return true;
+    }
 };
 
 template <class T>
@@ -17,37 +17,80 @@
  * Lesser General Public License for more details.
  */
 
+#include <algorithm>
 #include "carousel.h"
 
+void CarouselWindow::releaseSlots()
+{
+  for (auto & slot: slots) {
+    adapter->releaseItem(pool, slot.type, slot.window);
+  }
+  slots.clear();
+}
+
 void CarouselWindow::update()
 {
-  auto first = min<int>(selection - 2, items.size() - count);
+  int itemsCount = adapter->getItemsCount();
+  int first = min<int>(selection - 2, itemsCount - count);
+  first = max<int>(first, selection - (int)count + 1);
   first = max(0, first);
-  coord_t lastPosition = 0;
-  coord_t spacing = 10;
-  if (!items.empty() && count > 0)
-    spacing = (width() - items[0]->back->width() * (count - 1) - items[0]->front->width()) / (count - 1);
+  int last = min<int>(first + count, itemsCount);
 
-  int index = 0;
-  for (auto & item: items) {
-    Window * window;
-    if (index == selection) {
-      item->back->detach();
-      window = item->front;
+  // release the items which left the visible range or changed their selected state
+  size_t kept = 0;
+  for (auto & slot: slots) {
+    if (slot.index >= first && slot.index < last && slot.selected == (slot.index == selection)) {
+      slots[kept++] = slot;
     }
     else {
-      item->front->detach();
-      window = item->back;
+      adapter->releaseItem(pool, slot.type, slot.window);
+    }
+  }
+  slots.resize(kept);
+
+  // bind the items which entered it
+  for (int index = first; index < last; index++) {
+    auto it = std::find_if(slots.begin(), slots.end(), [=](const Slot & slot) {
+      return slot.index == index;
+    });
+    if (it == slots.end()) {
+      bool selected = (index == selection);
+      int type = adapter->getItemType(index, selected);
+      auto window = adapter->bindItem(this, index, selected, pool.acquire(type));
+      if (window->getParent() != this) {
+        window->attach(this);
+      }
+      slots.push_back({index, selected, type, window});
     }
-    window->attach(this);
+  }
+
+  std::sort(slots.begin(), slots.end(), [](const Slot & a, const Slot & b) {
+    return a.index < b.index;
+  });
+
+  coord_t spacing = 10;
+  if (slots.size() > 1 && count > 1) {
+    coord_t frontWidth = 0, backWidth = 0;
+    for (auto & slot: slots) {
+      if (slot.selected)
+        frontWidth = slot.window->width();
+      else
+        backWidth = slot.window->width();
+    }
+    if (frontWidth == 0)
+      frontWidth = backWidth;
+    spacing = (width() - backWidth * (count - 1) - frontWidth) / (count - 1);
+  }
+
+  coord_t lastPosition = 0;
+  for (auto & slot: slots) {
+    auto window = slot.window;
     window->setLeft(lastPosition);
     window->setTop((height() - window->height()) / 2);
-    if (index == first)
-      setScrollPositionX(lastPosition);
     lastPosition += window->width() + spacing;
-    index += 1;
   }
 
+  setScrollPositionX(0);
   setInnerWidth(lastPosition);
 }
 
@@ -57,7 +100,7 @@ void Carousel::onEvent(event_t event)
   TRACE_WINDOWS("%s received event 0x%X", getWindowDebugString().c_str(), event);
 
   if (event == EVT_ROTARY_RIGHT) {
-    if (body->selection < (int)body->items.size() - 1)
+    if (body->selection < body->getItemsCount() - 1)
       select(body->selection + 1);
   }
   else if (event == EVT_ROTARY_LEFT) {
@@ -21,6 +21,7 @@
 
 #include <vector>
 #include "button.h"
+#include "windowpool.h"
 
 class CarouselItem
 {
@@ -44,6 +45,70 @@ class CarouselItem
     std::function<void()> selectHandler;
 };
 
+// Binds the carousel items to windows, only the visible ones are bound
+class CarouselAdapter
+{
+  public:
+    virtual ~CarouselAdapter() = default;
+
+    virtual int getItemsCount() const = 0;
+
+    // windows are only recycled for items of the same type
+    virtual int getItemType(int index, bool selected) const
+    {
+      return selected ? 1 : 0;
+    }
+
+    // window is a recycled window of the same type, or nullptr
+    virtual Window * bindItem(Window * parent, int index, bool selected, Window * window) = 0;
+
+    virtual void releaseItem(WindowPool & pool, int type, Window * window)
+    {
+      pool.release(type, window);
+    }
+
+    virtual void onSelect(int index)
+    {
+    }
+};
+
+// The adapter used for items added with addItem(), their windows are owned by the items
+class CarouselItemsAdapter: public CarouselAdapter
+{
+  public:
+    explicit CarouselItemsAdapter(const std::vector<CarouselItem *> & items):
+      items(items)
+    {
+    }
+
+    int getItemsCount() const override
+    {
+      return items.size();
+    }
+
+    Window * bindItem(Window * parent, int index, bool selected, Window * window) override
+    {
+      auto item = items[index];
+      return selected ? item->front : item->back;
+    }
+
+    void releaseItem(WindowPool & pool, int type, Window * window) override
+    {
+      window->detach();
+    }
+
+    void onSelect(int index) override
+    {
+      auto item = items[index];
+      if (item->selectHandler) {
+        item->selectHandler();
+      }
+    }
+
+  protected:
+    const std::vector<CarouselItem *> & items;
+};
+
 class CarouselWindow: public Window
 {
   friend class Carousel;
@@ -51,8 +116,11 @@ class CarouselWindow: public Window
   public:
     CarouselWindow(Window * parent, const rect_t & rect, uint8_t count):
       Window(parent, rect, NO_SCROLLBAR),
-      count(count)
+      count(count),
+      itemsAdapter(items),
+      adapter(&itemsAdapter)
     {
+      slots.reserve(count);
     }
 
     void deleteLater(bool detach = true, bool trash = true) override // NOLINT(google-default-arguments)
@@ -70,10 +138,22 @@ class CarouselWindow: public Window
       update();
     }
 
+    // the adapter is not owned, nullptr goes back to the items added with addItem()
+    void setAdapter(CarouselAdapter * value)
+    {
+      releaseSlots();
+      adapter = value ? value : &itemsAdapter;
+      update();
+    }
+
+    int getItemsCount() const
+    {
+      return adapter->getItemsCount();
+    }
+
     void clear()
     {
-      // children will be deleted later (front and back)
-      children.clear();
+      releaseSlots();
 
       for (auto & item: items) {
         item->front->deleteLater();
@@ -81,24 +161,40 @@ class CarouselWindow: public Window
         delete item;
       }
       items.clear();
+
+      pool.clear();
     }
 
     void select(int index, bool scroll = true)
     {
       selection = index;
       if (selection >= 0) {
-        auto item = items[selection];
-        if (item->selectHandler) {
-          item->selectHandler();
-        }
+        adapter->onSelect(selection);
       }
       update();
     }
 
+    WindowPool & getPool()
+    {
+      return pool;
+    }
+
   protected:
+    struct Slot {
+      int index;
+      bool selected;
+      int type;
+      Window * window;
+    };
+
     std::vector<CarouselItem *> items;
     int selection = 0;
     unsigned count;
+    CarouselItemsAdapter itemsAdapter;
+    CarouselAdapter * adapter;
+    WindowPool pool;
+    std::vector<Slot> slots;
+    void releaseSlots();
     void update();
 };
 
@@ -122,6 +218,11 @@ class Carousel: public Window
       body->addItem(item);
     }
 
+    void setAdapter(CarouselAdapter * adapter)
+    {
+      body->setAdapter(adapter);
+    }
+
     void clear()
     {
       body->clear();
@@ -131,7 +232,7 @@ class Carousel: public Window
     {
       body->select(index);
       previousButton->enable(index > 0);
-      nextButton->enable(index < (int)body->items.size() - 1);
+      nextButton->enable(index < body->getItemsCount() - 1);
     }
 
     int getSelection() const
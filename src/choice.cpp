@@ -21,6 +21,71 @@
 #include "menu.h"
 #include "theme.h"
 
+const char * ChoiceValues::getText(size_t index, size_t & length) const
+{
+  if (table) {
+    length = strlen(table[index]);
+    return table[index];
+  }
+
+  if (packed) {
+    uint8_t size = packed[0];
+    const char * text = &packed[1 + index * size];
+    length = 0;
+    while (length < size && text[length] != '\0') {
+      length++;
+    }
+    return text;
+  }
+
+  length = owned[index].size();
+  return owned[index].c_str();
+}
+
+void ChoiceValues::setTable(const char * const * values, size_t valuesCount)
+{
+  clear();
+  table = values;
+  count = valuesCount;
+}
+
+void ChoiceValues::setPacked(const char * values, size_t valuesCount)
+{
+  clear();
+  packed = values;
+  count = valuesCount;
+}
+
+void ChoiceValues::assign(std::vector<std::string> values)
+{
+  clear();
+  owned = std::move(values);
+}
+
+void ChoiceValues::copyTable()
+{
+  if (table || packed) {
+    std::vector<std::string> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      values.push_back(getString(i));
+    }
+    assign(std::move(values));
+  }
+}
+
+void ChoiceValues::push_back(std::string value)
+{
+  copyTable();
+  owned.push_back(std::move(value));
+}
+
+void ChoiceValues::reserve(size_t capacity)
+{
+  copyTable();
+  owned.reserve(capacity);
+}
+
 Choice::Choice(FormGroup * parent, const rect_t & rect, int vmin, int vmax,
   std::function<int()> getValue, std::function<void(int)> setValue, WindowFlags windowFlags) :
   ChoiceBase(parent, rect, CHOICE_TYPE_DROPOWN, windowFlags),
@@ -45,12 +110,12 @@ Choice::Choice(FormGroup * parent, const rect_t & rect, const char * const value
 Choice::Choice(FormGroup * parent, const rect_t & rect, std::vector<std::string> values, int vmin, int vmax,
                std::function<int()> getValue, std::function<void(int)> setValue, WindowFlags windowFlags) :
   ChoiceBase(parent, rect, CHOICE_TYPE_DROPOWN, windowFlags),
-  values(std::move(values)),
   vmin(vmin),
   vmax(vmax),
   getValue(std::move(getValue)),
   setValue(std::move(setValue))
 {
+  this->values.assign(std::move(values));
 }
 
 Choice::Choice(FormGroup * parent, const rect_t & rect, const char * values, int vmin, int vmax,
@@ -62,43 +127,59 @@ Choice::Choice(FormGroup * parent, const rect_t & rect, const char * values, int
   setValue(std::move(setValue))
 {
   if (values) {
-    uint8_t len = values[0];
-    const char * value = &values[1];
-    for (int i = vmin; i <= vmax; i++) {
-      this->values.emplace_back(std::string(value, min<uint8_t>(len, strlen(value))));
-      value += len;
-    }
+    this->values.setPacked(values, vmax - vmin + 1);
+    this->values.copyTable();
   }
 }
 
 void Choice::addValue(const char * value)
 {
-  values.emplace_back(value);
+  values.push_back(value);
   vmax += 1;
+  invalidateSearchIndex();
 }
 
 void Choice::addValues(const char * const values[], uint8_t count)
 {
   this->values.reserve(this->values.size() + count);
   for (uint8_t i = 0; i < count; i++)
-    this->values.emplace_back(values[i]);
+    this->values.push_back(values[i]);
   vmax += count;
+  invalidateSearchIndex();
 }
 
 void Choice::setValues(std::vector<std::string> values)
 {
-  this->values = std::move(values);
+  this->values.assign(std::move(values));
+  invalidateSearchIndex();
 }
 
 void Choice::setValues(const char * const values[])
 {
   this->values.clear();
   if (values) {
-    auto value = &values[0];
-    for (int i = vmin; i <= vmax; i++) {
-      this->values.emplace_back(*value++);
-    }
+    this->values.setTable(values, vmax - vmin + 1);
+    this->values.copyTable();
+  }
+  invalidateSearchIndex();
+}
+
+void Choice::setValuesTable(const char * const values[])
+{
+  this->values.clear();
+  if (values) {
+    this->values.setTable(values, vmax - vmin + 1);
   }
+  invalidateSearchIndex();
+}
+
+void Choice::setValuesTable(const char * values)
+{
+  this->values.clear();
+  if (values) {
+    this->values.setPacked(values, vmax - vmin + 1);
+  }
+  invalidateSearchIndex();
 }
 
 void Choice::paint(BitmapBuffer * dc)
@@ -112,7 +193,7 @@ void Choice::paint(BitmapBuffer * dc)
   } else {
     val -= vmin;
     if (val >= 0 && val < (int)values.size()) {
-      str = values[val];
+      str = values.getString(val);
     }
   }
 
@@ -134,6 +215,16 @@ void Choice::onEvent(event_t event)
 }
 #endif
 
+std::string Choice::getMenuText(int value) const
+{
+  if (textHandler)
+    return textHandler(value);
+  else if (unsigned(value - vmin) < values.size())
+    return values.getString(value - vmin);
+  else
+    return std::to_string(value);
+}
+
 void Choice::openMenu()
 {
   auto menu = new Menu(this);
@@ -147,21 +238,9 @@ void Choice::openMenu()
   for (int i = vmin; i <= vmax; ++i) {
     if (isValueAvailable && !isValueAvailable(i))
       continue;
-    if (textHandler) {
-      menu->addLine(textHandler(i), [=]() {
-        setValue(i);
-      });
-    }
-    else if (unsigned(i - vmin) < values.size()) {
-      menu->addLine(values[i - vmin], [=]() {
-        setValue(i);
-      });
-    }
-    else {
-      menu->addLine(std::to_string(i), [=]() {
-        setValue(i);
-      });
-    }
+    menu->addLine(getMenuText(i), [=]() {
+      setValue(i);
+    });
     if (value == i) {
       current = count;
     }
@@ -172,6 +251,40 @@ void Choice::openMenu()
     menu->select(current);
   }
 
+  if (searchEnabled) {
+    if (!searchIndex) {
+      std::vector<std::string> texts;
+      texts.reserve(vmax - vmin + 1);
+      for (int i = vmin; i <= vmax; ++i) {
+        texts.push_back(getMenuText(i));
+      }
+      searchIndex = new SearchIndex(texts);
+    }
+
+    // the index has all the values, the menu only the available ones
+    std::vector<int> lineOfValue(vmax - vmin + 1, -1);
+    int line = 0;
+    for (int i = vmin; i <= vmax; ++i) {
+      if (!isValueAvailable || isValueAvailable(i)) {
+        lineOfValue[i - vmin] = line++;
+      }
+    }
+
+    // the entries found are kept for the next keystroke to narrow them down
+    std::vector<uint32_t> entries;
+    menu->setSearchHandler([=](const std::string & query, bool narrow, std::vector<uint32_t> & lines) mutable {
+      lines.clear();
+      if (!searchIndex)
+        return;
+      searchIndex->search(query, entries, narrow);
+      for (auto entry: entries) {
+        if (lineOfValue[entry] >= 0) {
+          lines.push_back(lineOfValue[entry]);
+        }
+      }
+    });
+  }
+
   if (beforeDisplayMenuHandler) {
     beforeDisplayMenuHandler(menu);
   }
@@ -21,9 +21,65 @@
 
 #include <vector>
 #include "form.h"
+#include "searchindex.h"
 
 class Menu;
 
+// The texts of the values of a Choice. Either owned strings, or a view on a
+// table in static data which is not copied: an array of strings, or a packed
+// table (the length of the entries followed by the entries, not null
+// terminated when they use the whole length)
+class ChoiceValues
+{
+  public:
+    size_t size() const
+    {
+      return (table || packed) ? count : owned.size();
+    }
+
+    bool empty() const
+    {
+      return size() == 0;
+    }
+
+    const char * getText(size_t index, size_t & length) const;
+
+    std::string getString(size_t index) const
+    {
+      size_t length;
+      auto text = getText(index, length);
+      return std::string(text, length);
+    }
+
+    void setTable(const char * const * values, size_t valuesCount);
+
+    void setPacked(const char * values, size_t valuesCount);
+
+    void assign(std::vector<std::string> values);
+
+    // the view becomes owned strings
+    void copyTable();
+
+    // the table is copied first
+    void push_back(std::string value);
+
+    void reserve(size_t capacity);
+
+    void clear()
+    {
+      owned.clear();
+      table = nullptr;
+      packed = nullptr;
+      count = 0;
+    }
+
+  protected:
+    std::vector<std::string> owned;
+    const char * const * table = nullptr;
+    const char * packed = nullptr;
+    size_t count = 0;
+};
+
 enum ChoiceType {
   CHOICE_TYPE_DROPOWN,
   CHOICE_TYPE_FOLDER,
@@ -54,6 +110,11 @@ class Choice: public ChoiceBase {
     Choice(FormGroup * parent, const rect_t & rect, const char * const values[], int vmin, int vmax, std::function<int()> getValue, std::function<void(int)> setValue = nullptr, WindowFlags windowFlags = 0);
     Choice(FormGroup * parent, const rect_t & rect, const char * values, int vmin, int vmax, std::function<int()> getValue, std::function<void(int)> setValue = nullptr, WindowFlags windowFlags = 0);
 
+    ~Choice() override
+    {
+      delete searchIndex;
+    }
+
     void addValue(const char * value);
 
     void addValues(const char * const values[], uint8_t count);
@@ -62,6 +123,11 @@ class Choice: public ChoiceBase {
 
     void setValues(const char * const values[]);
 
+    // the tables are not copied, they have to be static data
+    void setValuesTable(const char * const values[]);
+
+    void setValuesTable(const char * values);
+
 #if defined(DEBUG_WINDOWS)
     std::string getName() const override
     {
@@ -134,6 +200,13 @@ class Choice: public ChoiceBase {
     void setTextHandler(std::function<std::string(int)> handler)
     {
       textHandler = std::move(handler);
+      invalidateSearchIndex();
+    }
+
+    // adds a search field to the menu, for long lists of values
+    void setSearchEnabled(bool value)
+    {
+      searchEnabled = value;
     }
 
     void setMenuTitle(std::string value)
@@ -144,17 +217,19 @@ class Choice: public ChoiceBase {
     void setMin(int value)
     {
       vmin = value;
+      invalidateSearchIndex();
       invalidate();
     }
 
     void setMax(int value)
     {
       vmax = value;
+      invalidateSearchIndex();
       invalidate();
     }
 
   protected:
-    std::vector<std::string> values;
+    ChoiceValues values;
     int vmin = 0;
     int vmax = 0;
     std::string menuTitle;
@@ -163,6 +238,17 @@ class Choice: public ChoiceBase {
     std::function<bool(int)> isValueAvailable;
     std::function<std::string(int)> textHandler;
     std::function <void(Menu *)> beforeDisplayMenuHandler;
+    bool searchEnabled = false;
+    // built when the menu is opened, kept while the values don't change
+    SearchIndex * searchIndex = nullptr;
+
+    void invalidateSearchIndex()
+    {
+      delete searchIndex;
+      searchIndex = nullptr;
+    }
+
+    std::string getMenuText(int value) const;
 
     virtual void openMenu();
 };
@@ -22,13 +22,6 @@
 
 constexpr int LONG_PRESS_10MS = 40;
 
-extern inline tmr10ms_t getTicks()
-{
-  return g_tmr10ms;
-}
-
-
-
 void ChoiceEx::setLongPressHandler(std::function<void(event_t)> handler)
 {
   longPressHandler = handler;
@@ -37,9 +30,19 @@ void ChoiceEx::setLongPressHandler(std::function<void(event_t)> handler)
 ChoiceEx::ChoiceEx(FormGroup * parent, const rect_t & rect, int16_t vmin, int16_t vmax, std::function<int16_t()> getValue, 
                    std::function<void(int16_t)> setValue, WindowFlags windowFlags) :
   Choice(parent, rect, vmin, vmax, getValue, setValue, windowFlags)
+#if defined(HARDWARE_TOUCH)
+  , longPressTimer(this)
+#endif
 {
 #if defined(HARDWARE_TOUCH)
-  duration10ms = 0;
+  longPressTimer.setHandler([=]() {
+    if (!longPressed && longPressHandler) {
+      event_t event = getEvent();
+      longPressHandler(event);
+      killEvents(event);
+      longPressed = true;
+    }
+  });
 #endif
 }
 
@@ -59,36 +62,10 @@ void ChoiceEx::onEvent(event_t event)
 #endif
 
 #if defined(HARDWARE_TOUCH)
-bool ChoiceEx::isLongPress()
-{
-  unsigned int curTimer = getTicks();
-  return (!longPressed && duration10ms != 0 && curTimer - duration10ms > LONG_PRESS_10MS);
-}
-
-void ChoiceEx::checkEvents(void)
-{
-  event_t event = getEvent();
-
-  if (isLongPress()) {
-    if (!longPressed && longPressHandler) {
-      longPressHandler(event);
-      killEvents(event);
-      duration10ms = 0;
-      longPressed = true;
-      return;
-    }
-  }
-
-  if (hasFocus())
-    onEvent(event);
-  else
-    pushEvent(event);
-}
-
 bool ChoiceEx::onTouchStart(coord_t x, coord_t y)
 {
-  if (!longPressed && duration10ms == 0) {
-    duration10ms = getTicks();
+  if (!longPressed && !longPressTimer.isRunning()) {
+    longPressTimer.start(LONG_PRESS_10MS * 10);
   }
 
   return Choice::onTouchStart(x, y);
@@ -102,7 +79,7 @@ bool ChoiceEx::onTouchEnd(coord_t x, coord_t y)
     return false;
   }
 
-  duration10ms = 0;
+  longPressTimer.stop();
   return Choice::onTouchEnd(x,y);
 }
 #endif
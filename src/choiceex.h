@@ -21,6 +21,7 @@
 #ifndef _CHOICEEX_H_
 #define _CHOICEEX_H_
 #include "choice.h"
+#include "timer.h"
 
 class ChoiceEx : public Choice
 {
@@ -37,8 +38,6 @@ class ChoiceEx : public Choice
 #if defined(HARDWARE_TOUCH)
     bool onTouchEnd(coord_t x, coord_t y) override;
     bool onTouchStart(coord_t x, coord_t y) override;
-    void checkEvents(void) override;
-    bool isLongPress();
 #endif
 
 #if defined(DEBUG_WINDOWS)
@@ -52,8 +51,8 @@ protected:
     std::function<void(event_t)> longPressHandler = nullptr;
 
 #if defined(HARDWARE_TOUCH)
-    uint32_t duration10ms;
     bool longPressed = false;
+    Timer longPressTimer;
 #endif
 };
 
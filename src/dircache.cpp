@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <algorithm>
+#include <unordered_set>
+#include "dircache.h"
+#include "mainwindow.h"
+
+ExtensionMatcher::ExtensionMatcher(const char * pattern)
+{
+  if (!pattern)
+    return;
+
+  // same split as isExtensionMatching(), each extension begins with a period
+  const char * extension = pattern;
+  while (*extension == '.') {
+    const char * end = strchr(extension + 1, '.');
+    size_t length = end ? end - extension : strlen(extension);
+    std::string value(extension, length);
+    for (auto & c: value) {
+      if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+    }
+    extensions.push_back(value);
+    extension += length;
+  }
+}
+
+bool ExtensionMatcher::matches(const char * extension, uint8_t length) const
+{
+  for (const auto & value: extensions) {
+    if (value.size() == length && !strncasecmp(extension, value.c_str(), length)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t DirectoryCache::getSignature(const std::string & folder)
+{
+  FILINFO info;
+  if (f_stat(folder.c_str(), &info) != FR_OK)
+    return 0;
+  return (uint32_t(info.fdate) << 16u) + uint16_t(info.ftime);
+}
+
+std::shared_ptr<const FilesList> DirectoryCache::readFiles(const std::string & folder, const ExtensionMatcher & matcher, int maxlen, bool stripExtension)
+{
+  auto files = std::make_shared<FilesList>();
+
+  DIR dir;
+  if (f_opendir(&dir, folder.c_str()) != FR_OK)
+    return files;
+
+  std::unordered_set<std::string> names;
+  FILINFO info;
+  bool firstTime = true;
+  while (sdReadDir(&dir, &info, firstTime) == FR_OK && info.fname[0] != 0) {
+    if (info.fattrib & (AM_DIR | AM_HID | AM_SYS))
+      continue;
+
+    uint8_t nameLength, extensionLength;
+    auto extension = getFileExtension(info.fname, 0, 0, &nameLength, &extensionLength);
+    if (!matcher.isEmpty() && (!extension || !matcher.matches(extension, extensionLength)))
+      continue;
+
+    if (stripExtension)
+      nameLength -= extensionLength;
+
+    if (!nameLength || nameLength > maxlen)
+      continue;
+
+    // the same name with several extensions is listed once
+    std::string name(info.fname, nameLength);
+    if (names.insert(name).second) {
+      files->push_back(std::move(name));
+    }
+  }
+  f_closedir(&dir);
+
+  std::sort(files->begin(), files->end(), compare_nocase);
+  return files;
+}
+
+DirectoryCache::Entry * DirectoryCache::findEntry(const std::string & folder, const std::string & extension, int maxlen, bool stripExtension)
+{
+  for (auto & entry: entries) {
+    if (entry.folder == folder && entry.extension == extension && entry.maxlen == maxlen && entry.stripExtension == stripExtension) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+void DirectoryCache::startScan(Entry & entry)
+{
+  auto scan = std::make_shared<Scan>();
+  scan->done = false;
+  entry.scan = scan;
+  entry.stale = false;
+
+  auto folder = entry.folder;
+  auto pattern = entry.extension;
+  auto maxlen = entry.maxlen;
+  auto stripExtension = entry.stripExtension;
+  executor([=]() {
+    scan->files = readFiles(folder, ExtensionMatcher(pattern.c_str()), maxlen, stripExtension);
+    scan->done.store(true, std::memory_order_release);
+    // posted once, when the queue is full the result is taken by the next getFiles()
+    MainWindow::post([=]() {
+      auto & cache = DirectoryCache::instance();
+      auto entry = cache.findEntry(folder, pattern, maxlen, stripExtension);
+      if (entry) {
+        cache.applyScan(*entry);
+      }
+    });
+  });
+}
+
+void DirectoryCache::applyScan(Entry & entry)
+{
+  if (!entry.scan || !entry.scan->done.load(std::memory_order_acquire))
+    return;
+
+  entry.files = entry.scan->files;
+  entry.searchIndex = nullptr;
+  entry.scan = nullptr;
+
+  if (entry.stale) {
+    // the folder changed while it was read
+    startScan(entry);
+  }
+}
+
+std::shared_ptr<const FilesList> DirectoryCache::getFiles(const std::string & folder, const char * extension, int maxlen, bool stripExtension)
+{
+  std::string pattern(extension ? extension : "");
+  auto signature = getSignature(folder);
+  auto entry = findEntry(folder, pattern, maxlen, stripExtension);
+
+  if (entry) {
+    applyScan(*entry);
+  }
+
+  if (entry && entry->valid && entry->signature == signature) {
+    return entry->files;
+  }
+
+  if (!entry) {
+    entries.push_back({folder, pattern, maxlen, stripExtension, nullptr, 0, false, false, nullptr, nullptr});
+    entry = &entries.back();
+  }
+  entry->signature = signature;
+  entry->valid = true;
+
+  if (!executor || !entry->files) {
+    // nothing to show meanwhile, the folder is read now
+    entry->files = readFiles(folder, ExtensionMatcher(extension), maxlen, stripExtension);
+    entry->searchIndex = nullptr;
+    return entry->files;
+  }
+
+  if (entry->scan)
+    entry->stale = true;
+  else
+    startScan(*entry);
+
+  // the previous list, until the new one is read
+  return entry->files;
+}
+
+std::shared_ptr<const SearchIndex> DirectoryCache::getSearchIndex(const std::shared_ptr<const FilesList> & files)
+{
+  for (auto & entry: entries) {
+    if (entry.files == files) {
+      if (!entry.searchIndex) {
+        entry.searchIndex = std::make_shared<SearchIndex>(*files);
+      }
+      return entry.searchIndex;
+    }
+  }
+
+  // a list which was replaced since, its index isn't kept
+  return std::make_shared<SearchIndex>(*files);
+}
+
+void DirectoryCache::invalidate(const std::string & folder)
+{
+  for (auto & entry: entries) {
+    if (entry.folder == folder) {
+      entry.valid = false;
+      if (entry.scan) {
+        entry.stale = true;
+      }
+    }
+  }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include "libopenui_file.h"
+#include "searchindex.h"
+
+// Extensions list parsed once, from a pattern like ".gif.jpg.jpeg.png"
+class ExtensionMatcher
+{
+  public:
+    explicit ExtensionMatcher(const char * pattern = nullptr);
+
+    bool isEmpty() const
+    {
+      return extensions.empty();
+    }
+
+    // extension includes the leading period
+    bool matches(const char * extension, uint8_t length) const;
+
+  protected:
+    std::vector<std::string> extensions;
+};
+
+typedef std::vector<std::string> FilesList;
+
+// the worker reads the folders while the UI thread calls f_stat(),
+// which needs FatFS built with FF_FS_REENTRANT
+#if (defined(FF_FS_REENTRANT) && FF_FS_REENTRANT) || (defined(_FS_REENTRANT) && _FS_REENTRANT)
+  #define DIRECTORY_CACHE_EXECUTOR
+#endif
+
+// Sorted lists of the files of the SD card folders, kept between two uses.
+// A list is read again when the folder date changes or after invalidate().
+// With an executor the list is read again on a worker thread, the previous
+// one being returned meanwhile
+class DirectoryCache
+{
+  public:
+    typedef std::function<void(std::function<void()> /*task*/)> Executor;
+
+    static DirectoryCache & instance()
+    {
+      static DirectoryCache cache;
+      return cache;
+    }
+
+#if defined(DIRECTORY_CACHE_EXECUTOR)
+    void setExecutor(Executor value)
+    {
+      executor = std::move(value);
+    }
+#endif
+
+    // the files of folder with one of the extensions of the pattern (all
+    // files without pattern), sorted without case
+    std::shared_ptr<const FilesList> getFiles(const std::string & folder, const char * extension, int maxlen, bool stripExtension);
+
+    // the search index of a list returned by getFiles(), built once and kept
+    // with the list
+    std::shared_ptr<const SearchIndex> getSearchIndex(const std::shared_ptr<const FilesList> & files);
+
+    // to be called after the content of the folder has changed, a read in
+    // progress is done again
+    void invalidate(const std::string & folder);
+
+    void clear()
+    {
+      entries.clear();
+    }
+
+  protected:
+    // filled by the worker, taken by the UI thread once done
+    struct Scan {
+      std::shared_ptr<const FilesList> files;
+      std::atomic<bool> done;
+    };
+
+    struct Entry {
+      std::string folder;
+      std::string extension;
+      int maxlen;
+      bool stripExtension;
+      std::shared_ptr<const FilesList> files;
+      uint32_t signature;
+      bool valid;
+      // the folder changed while it was read
+      bool stale;
+      std::shared_ptr<Scan> scan;
+      // built on the first search in files
+      std::shared_ptr<const SearchIndex> searchIndex;
+    };
+    std::vector<Entry> entries;
+    Executor executor;
+
+    static uint32_t getSignature(const std::string & folder);
+
+    static std::shared_ptr<const FilesList> readFiles(const std::string & folder, const ExtensionMatcher & matcher, int maxlen, bool stripExtension);
+
+    Entry * findEntry(const std::string & folder, const std::string & extension, int maxlen, bool stripExtension);
+
+    void startScan(Entry & entry);
+
+    void applyScan(Entry & entry);
+};
@@ -22,6 +22,7 @@
 #include "menu.h"
 #include "theme.h"
 #include "message_dialog.h"
+#include "dircache.h"
 
 #include <algorithm>
 
@@ -56,71 +57,40 @@ void FileChoice::paint(BitmapBuffer * dc)
 
 bool FileChoice::openMenu()
 {
-  FILINFO fno;
-  DIR dir;
-  std::list<std::string> files;
-  const char *fnExt;
-  uint8_t fnLen, extLen;
-
-  FRESULT res = f_opendir(&dir, folder.c_str());  // Open the directory
-  if (res == FR_OK) {
-    bool firstTime = true;
-    for (;;) {
-      res = sdReadDir(&dir, &fno, firstTime);
-      if (res != FR_OK || fno.fname[0] == 0)
-        break;                             // break on error or end of dir
-      if (fno.fattrib & AM_DIR) continue;  // skip subfolders
-      if (fno.fattrib & AM_HID) continue;  // skip hidden files
-      if (fno.fattrib & AM_SYS) continue;  // skip system files
-
-      fnExt = getFileExtension(fno.fname, 0, 0, &fnLen, &extLen);
-
-      if (extension && (!fnExt || !isExtensionMatching(fnExt, extension)))
-        continue;  // wrong extension
-
-      if (stripExtension) fnLen -= extLen;
-
-      if (!fnLen || fnLen > maxlen) continue;  // wrong size
-
-      // eject duplicates
-      std::string newFile(fno.fname, fnLen);
-      if (std::find(files.begin(), files.end(), newFile) != files.end())
-        continue;
-
-      files.emplace_back(newFile);
+  auto files = DirectoryCache::instance().getFiles(folder, extension, maxlen, stripExtension);
+
+  if (!files->empty()) {
+    auto menu = new Menu(this);
+    std::string value = getValue();
+
+    // the first line is the empty value
+    menu->setLineProvider(files->size() + 1, [=](unsigned index) {
+      return index == 0 ? std::string() : (*files)[index - 1];
+    }, [=](unsigned index) {
+      setValue(index == 0 ? std::string() : (*files)[index - 1]);
+    });
+
+    if (searchEnabled) {
+      // the index is kept by the cache with the list, the empty value isn't searched
+      menu->setSearchIndex(DirectoryCache::instance().getSearchIndex(files), 1);
     }
 
-    if (!files.empty()) {
-      // sort files
-      files.sort(compare_nocase);
-      files.push_front("");
-
-      auto menu = new Menu(this);
-      int count = 0;
-      int current = -1;
-      std::string value = getValue();
-      for (const auto &file : files) {
-        menu->addLine(file, [=]() { setValue(file); });
-        // TRACE("%s %d %s %d", value.c_str(), value.size(), file.c_str(),
-        // file.size());
-        if (value.compare(file) == 0) {
-          // TRACE("OK");
-          current = count;
-        }
-        ++count;
-      }
-
-      if (current >= 0) {
-        menu->select(current);
+    if (value.empty()) {
+      menu->select(0);
+    }
+    else {
+      auto it = std::find(files->begin(), files->end(), value);
+      if (it != files->end()) {
+        menu->select(it - files->begin() + 1);
       }
+    }
 
-      menu->setCloseHandler([=]() {
-        editMode = false;
-        setFocus(SET_FOCUS_DEFAULT);
-      });
+    menu->setCloseHandler([=]() {
+      editMode = false;
+      setFocus(SET_FOCUS_DEFAULT);
+    });
 
-      return true;
-    }
+    return true;
   }
 
   new MessageDialog(this, STR_SDCARD, STR_NO_FILES_ON_SD);
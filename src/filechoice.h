@@ -37,6 +37,9 @@ public:
 
   void paint(BitmapBuffer* dc) override;
 
+  // adds a search field to the menu, for folders with many files
+  void setSearchEnabled(bool value) { searchEnabled = value; }
+
 #if defined(HARDWARE_KEYS)
   void onEvent(event_t event) override;
 #endif
@@ -52,6 +55,7 @@ protected:
   std::function<std::string()> getValue;
   std::function<void(std::string)> setValue;
   bool stripExtension;
+  bool searchEnabled = false;
 
   bool openMenu();
 };
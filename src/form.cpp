@@ -227,7 +227,7 @@ void FormGroup::setFocus(uint8_t flag, Window * from)
           }
           else {
             clearFocus();
-            focusWindow = this;
+            setFocusWindow(this);
           }
         }
         else if (next) {
@@ -235,7 +235,7 @@ void FormGroup::setFocus(uint8_t flag, Window * from)
         }
         else {
           clearFocus();
-          focusWindow = this;
+          setFocusWindow(this);
         }
         break;
     }
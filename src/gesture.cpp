@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <math.h>
+#include "gesture.h"
+#include "libopenui_config.h"
+
+void GestureTracker::start(coord_t x, coord_t y, uint32_t time)
+{
+  samples[0] = {x, y, time};
+  samplesCount = 1;
+  lastSample = 0;
+  reportedX = x;
+  reportedY = y;
+  flinging = false;
+}
+
+void GestureTracker::addSample(coord_t x, coord_t y, uint32_t time)
+{
+  if (samplesCount == 0) {
+    start(x, y, time);
+    return;
+  }
+
+  lastSample = (lastSample + 1) % GESTURE_SAMPLES_MAX;
+  samples[lastSample] = {x, y, time};
+  if (samplesCount < GESTURE_SAMPLES_MAX) {
+    samplesCount++;
+  }
+}
+
+void GestureTracker::fit(float & x, float & velocityX, float & y, float & velocityY) const
+{
+  const Sample & last = samples[lastSample];
+  float sumT = 0, sumX = 0, sumY = 0;
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < samplesCount; i++) {
+    const Sample & sample = samples[(lastSample + GESTURE_SAMPLES_MAX - i) % GESTURE_SAMPLES_MAX];
+    float t = -float(last.time - sample.time) / SYSTEM_TICKS_1MS;
+    if (-t > GESTURE_HISTORY_MS)
+      break;
+    sumT += t;
+    sumX += sample.x;
+    sumY += sample.y;
+    count++;
+  }
+
+  float meanT = sumT / count;
+  float meanX = sumX / count;
+  float meanY = sumY / count;
+  float sumTT = 0, sumTX = 0, sumTY = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    const Sample & sample = samples[(lastSample + GESTURE_SAMPLES_MAX - i) % GESTURE_SAMPLES_MAX];
+    float t = -float(last.time - sample.time) / SYSTEM_TICKS_1MS - meanT;
+    sumTT += t * t;
+    sumTX += t * (sample.x - meanX);
+    sumTY += t * (sample.y - meanY);
+  }
+
+  if (sumTT > 0) {
+    velocityX = sumTX / sumTT;
+    velocityY = sumTY / sumTT;
+    x = meanX - velocityX * meanT;
+    y = meanY - velocityY * meanT;
+  }
+  else {
+    // a single sample, or all of them at the same time
+    velocityX = velocityY = 0;
+    x = last.x;
+    y = last.y;
+  }
+}
+
+void GestureTracker::getVelocity(float & velocityX, float & velocityY) const
+{
+  if (samplesCount == 0) {
+    velocityX = velocityY = 0;
+    return;
+  }
+
+  float x, y;
+  fit(x, velocityX, y, velocityY);
+  velocityX *= 1000;
+  velocityY *= 1000;
+
+  float velocity = sqrtf(velocityX * velocityX + velocityY * velocityY);
+  if (velocity > FLING_MAX_VELOCITY) {
+    velocityX = velocityX * FLING_MAX_VELOCITY / velocity;
+    velocityY = velocityY * FLING_MAX_VELOCITY / velocity;
+  }
+}
+
+void GestureTracker::getSlideDelta(uint32_t time, coord_t & deltaX, coord_t & deltaY)
+{
+  deltaX = deltaY = 0;
+  if (samplesCount == 0)
+    return;
+
+  float x, velocityX, y, velocityY;
+  fit(x, velocityX, y, velocityY);
+
+  uint32_t elapsed = (time - samples[lastSample].time) / SYSTEM_TICKS_1MS + GESTURE_PREDICTION_MS;
+  if (elapsed > GESTURE_EXTRAPOLATION_MS) {
+    elapsed = GESTURE_EXTRAPOLATION_MS;
+  }
+
+  auto estimatedX = coord_t(lroundf(x + velocityX * elapsed));
+  auto estimatedY = coord_t(lroundf(y + velocityY * elapsed));
+  deltaX = estimatedX - reportedX;
+  deltaY = estimatedY - reportedY;
+  reportedX = estimatedX;
+  reportedY = estimatedY;
+}
+
+bool GestureTracker::startFling(uint32_t time)
+{
+  getVelocity(flingVelocityX, flingVelocityY);
+  flinging = sqrtf(flingVelocityX * flingVelocityX + flingVelocityY * flingVelocityY) >= FLING_MIN_VELOCITY;
+  flingStart = time;
+  flingX = flingY = 0;
+  samplesCount = 0;
+  return flinging;
+}
+
+bool GestureTracker::stepFling(uint32_t time, coord_t & deltaX, coord_t & deltaY)
+{
+  deltaX = deltaY = 0;
+  if (!flinging)
+    return false;
+
+  // exponential decay of the velocity, the distance tends to v0.tau
+  float decay = expf(-float(time - flingStart) / SYSTEM_TICKS_1MS / FLING_TIME_CONSTANT_MS);
+  float distance = FLING_TIME_CONSTANT_MS / 1000 * (1 - decay);
+  auto x = coord_t(lroundf(flingVelocityX * distance));
+  auto y = coord_t(lroundf(flingVelocityY * distance));
+  deltaX = x - flingX;
+  deltaY = y - flingY;
+  flingX = x;
+  flingY = y;
+
+  if (sqrtf(flingVelocityX * flingVelocityX + flingVelocityY * flingVelocityY) * decay < FLING_MIN_VELOCITY) {
+    flinging = false;
+  }
+
+  return flinging;
+}
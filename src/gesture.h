@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include "libopenui_types.h"
+
+constexpr uint8_t GESTURE_SAMPLES_MAX = 8;
+constexpr uint32_t GESTURE_HISTORY_MS = 100;     // older samples are not used for the velocity
+constexpr uint32_t GESTURE_PREDICTION_MS = 8;    // the position is estimated this far ahead of the frame time
+constexpr uint32_t GESTURE_EXTRAPOLATION_MS = 24; // never further than this after the last sample
+constexpr float FLING_TIME_CONSTANT_MS = 325.0f;
+constexpr float FLING_MIN_VELOCITY = 20.0f;      // in pixels per second
+constexpr float FLING_MAX_VELOCITY = 4000.0f;
+
+// Tracks the samples of a touch gesture. The slide deltas are taken on the
+// line fitted through the recent samples at the frame time, so that they don't
+// depend on when the panel was sampled, and the fling after the release is a
+// function of the elapsed time, not of the number of frames. Times are
+// ticksNow() values
+class GestureTracker
+{
+  public:
+    void start(coord_t x, coord_t y, uint32_t time);
+
+    void addSample(coord_t x, coord_t y, uint32_t time);
+
+    // the move of the estimated position since the previous call
+    void getSlideDelta(uint32_t time, coord_t & deltaX, coord_t & deltaY);
+
+    // in pixels per second
+    void getVelocity(float & velocityX, float & velocityY) const;
+
+    // returns false when the gesture was too slow to be continued
+    bool startFling(uint32_t time);
+
+    // the fling move since the previous call, returns false once stopped
+    bool stepFling(uint32_t time, coord_t & deltaX, coord_t & deltaY);
+
+    bool isFlinging() const
+    {
+      return flinging;
+    }
+
+    void stopFling()
+    {
+      flinging = false;
+    }
+
+  protected:
+    struct Sample {
+      coord_t x;
+      coord_t y;
+      uint32_t time;
+    };
+    Sample samples[GESTURE_SAMPLES_MAX];
+    uint8_t samplesCount = 0;
+    uint8_t lastSample = 0;
+    coord_t reportedX = 0;
+    coord_t reportedY = 0;
+
+    bool flinging = false;
+    uint32_t flingStart = 0;
+    float flingVelocityX = 0;
+    float flingVelocityY = 0;
+    coord_t flingX = 0;
+    coord_t flingY = 0;
+
+    // fits x = a + b.t and y = c + d.t through the recent samples, t in ms
+    // relative to the last sample
+    void fit(float & x, float & velocityX, float & y, float & velocityY) const;
+};
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "input.h"
+#include "libopenui_depends.h"
+
+bool InputQueue::isCoalescing(event_t event)
+{
+#if defined(HARDWARE_KEYS)
+  return event == EVT_ROTARY_RIGHT || event == EVT_ROTARY_LEFT;
+#else
+  return false;
+#endif
+}
+
+void InputQueue::push(const InputEvent & input)
+{
+  if (count > 0 && events[count - 1].event == input.event && isCoalescing(input.event) && events[count - 1].count + input.count <= UINT16_MAX) {
+    events[count - 1].count += input.count;
+  }
+  else if (count < INPUT_QUEUE_SIZE) {
+    events[count++] = input;
+  }
+}
+
+void InputQueue::pushFront(const InputEvent & input)
+{
+  if (count > 0 && events[0].event == input.event && isCoalescing(input.event) && events[0].count + input.count <= UINT16_MAX) {
+    events[0].count += input.count;
+    events[0].timestamp = input.timestamp;
+    return;
+  }
+
+  if (count == INPUT_QUEUE_SIZE) {
+    count--;
+  }
+  for (uint8_t i = count; i > 0; i--) {
+    events[i] = events[i - 1];
+  }
+  events[0] = input;
+  count++;
+}
+
+bool InputQueue::pop(InputEvent & input)
+{
+  if (count == 0) {
+    event_t event = getWindowEvent();
+    if (!event)
+      return false;
+    push({event, 1, ticksNow()});
+  }
+
+  input = events[0];
+  for (uint8_t i = 1; i < count; i++) {
+    events[i - 1] = events[i];
+  }
+  count--;
+
+  if (isCoalescing(input.event) && count == 0) {
+    while (input.count < UINT16_MAX) {
+      event_t event = getWindowEvent();
+      if (!event)
+        break;
+      if (event != input.event) {
+        push({event, 1, ticksNow()});
+        break;
+      }
+      input.count++;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include "libopenui_types.h"
+#include "libopenui_config.h"
+
+constexpr uint8_t INPUT_QUEUE_SIZE = 4;
+
+// An event of the focused window, with the number of consecutive identical
+// rotary steps it stands for
+struct InputEvent
+{
+  event_t event;
+  uint16_t count;
+  uint32_t timestamp; // ticksNow() value of the first step
+};
+
+// Reads the events from getWindowEvent(). The rotary steps available at once
+// are coalesced into one event, the reading stops at the first other event
+// which is kept for the next call
+class InputQueue
+{
+  public:
+    bool pop(InputEvent & input);
+
+    // puts back the steps not consumed by a window which lost the focus
+    void pushFront(const InputEvent & input);
+
+    void clear()
+    {
+      count = 0;
+    }
+
+    static bool isCoalescing(event_t event);
+
+  protected:
+    InputEvent events[INPUT_QUEUE_SIZE];
+    uint8_t count = 0;
+
+    void push(const InputEvent & input);
+};
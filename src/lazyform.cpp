@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#include <algorithm>
+#include "lazyform.h"
+
+void LazyFormGroup::addRow(coord_t height, RowFactory factory, int type)
+{
+  coord_t top = rowsHeight;
+  rows.push_back({top, height, type, std::move(factory), nullptr});
+  rowsHeight += height + PAGE_LINE_SPACING;
+  setInnerHeight(rowsHeight);
+
+  coord_t visibleTop, visibleBottom;
+  getVisibleRange(visibleTop, visibleBottom);
+  if (top < visibleBottom && top + height > visibleTop) {
+    buildRow(rows.size() - 1);
+  }
+}
+
+void LazyFormGroup::clear()
+{
+  while (!built.empty()) {
+    releaseRow(built.back());
+  }
+  rows.clear();
+  pool.clear();
+  rowsHeight = 0;
+  FormGroup::clear();
+}
+
+void LazyFormGroup::getVisibleRange(coord_t & top, coord_t & bottom) const
+{
+  top = getScrollPositionY();
+  bottom = top + height();
+
+  // the parents scroll this group when it has FORWARD_SCROLL, shift is the
+  // offset from the group content to the parent content
+  coord_t shift = 0;
+  for (const Window * window = this; window->getParent() && top < bottom; window = window->getParent()) {
+    auto parent = window->getParent();
+    shift += window->top() - window->getScrollPositionY();
+    top = max(top, parent->getScrollPositionY() - shift);
+    bottom = min(bottom, parent->getScrollPositionY() + parent->height() - shift);
+  }
+}
+
+int LazyFormGroup::getRowIndex(Window * window) const
+{
+  if (window) {
+    for (auto index: built) {
+      if (window->isChild(rows[index].window)) {
+        return index;
+      }
+    }
+  }
+  return -1;
+}
+
+Window * LazyFormGroup::buildRow(uint32_t index)
+{
+  auto & row = rows[index];
+  if (row.window)
+    return row.window;
+
+  rect_t rect = {0, row.top, width(), row.height};
+  Window * recycled = row.type == LAZY_ROW_NOT_RECYCLED ? nullptr : pool.acquire(row.type);
+  auto window = row.factory(this, rect, recycled);
+  if (window->getParent() != this) {
+    window->attach(this);
+  }
+  window->setTop(row.top);
+  row.window = window;
+
+  built.insert(std::lower_bound(built.begin(), built.end(), index), index);
+  linkRows();
+  return window;
+}
+
+void LazyFormGroup::releaseRow(uint32_t index)
+{
+  auto & row = rows[index];
+  if (row.type == LAZY_ROW_NOT_RECYCLED)
+    row.window->deleteLater();
+  else
+    pool.release(row.type, row.window);
+  row.window = nullptr;
+
+  built.erase(std::lower_bound(built.begin(), built.end(), index));
+}
+
+void LazyFormGroup::linkRows()
+{
+  // rows are only linked together when the rows between them are built,
+  // otherwise the chain goes through this group which builds the next one
+  first = nullptr;
+  last = nullptr;
+  FormField * previousField = nullptr;
+  bool gap = false;
+  uint32_t previousIndex = 0;
+
+  for (auto index: built) {
+    if (previousField && index != previousIndex + 1) {
+      gap = true;
+    }
+    previousIndex = index;
+
+    auto field = dynamic_cast<FormField *>(rows[index].window);
+    if (!field || (field->getWindowFlags() & (NO_FOCUS | FORM_DETACHED)))
+      continue;
+
+    if (!previousField) {
+      field->setPreviousField(this);
+      first = field;
+    }
+    else if (gap) {
+      previousField->setNextField(this);
+      field->setPreviousField(this);
+    }
+    else {
+      link(previousField, field);
+    }
+    previousField = field;
+    gap = false;
+  }
+
+  if (previousField) {
+    previousField->setNextField(this);
+    last = previousField;
+  }
+}
+
+void LazyFormGroup::updateRows()
+{
+  coord_t top, bottom;
+  getVisibleRange(top, bottom);
+  visibleTop = top;
+  visibleBottom = bottom;
+
+  auto begin = std::partition_point(rows.begin(), rows.end(), [=](const Row & row) {
+    return row.top + row.height <= top;
+  });
+  auto end = std::partition_point(begin, rows.end(), [=](const Row & row) {
+    return row.top < bottom;
+  });
+  uint32_t first = begin - rows.begin();
+  uint32_t last = end - rows.begin();
+
+  // the focused row is kept until the focus leaves it
+  int focused = getRowIndex(getFocus());
+  focusedRow = focused;
+
+  bool changed = false;
+  for (size_t i = 0; i < built.size();) {
+    auto index = built[i];
+    if ((index < first || index >= last) && (int)index != focused) {
+      releaseRow(index);
+      changed = true;
+    }
+    else {
+      i++;
+    }
+  }
+
+  if (changed) {
+    linkRows();
+  }
+
+  for (auto index = first; index < last; index++) {
+    buildRow(index);
+  }
+}
+
+void LazyFormGroup::checkEvents()
+{
+  FormGroup::checkEvents();
+
+  if (_deleted)
+    return;
+
+  // the ancestors scroll or resize this group without telling it, and the
+  // focus moves between directly linked rows without going through it
+  coord_t top, bottom;
+  getVisibleRange(top, bottom);
+  if (top != visibleTop || bottom != visibleBottom || getRowIndex(getFocus()) != focusedRow) {
+    updateRows();
+  }
+}
+
+void LazyFormGroup::focusRow(int index, int direction, bool wrap)
+{
+  for (; index >= 0 && index < (int)rows.size(); index += direction) {
+    auto field = dynamic_cast<FormField *>(buildRow(index));
+    if (field && !(field->getWindowFlags() & (NO_FOCUS | FORM_DETACHED))) {
+      field->setFocus(direction > 0 ? SET_FOCUS_FORWARD : SET_FOCUS_BACKWARD, this);
+      // the rows built on the way are released if out of view
+      updateRows();
+      return;
+    }
+  }
+
+  // past the ends
+  if (direction > 0 && next && next != this) {
+    next->setFocus(SET_FOCUS_FORWARD, this);
+  }
+  else if (direction < 0 && previous && previous != this) {
+    previous->setFocus(SET_FOCUS_BACKWARD, this);
+  }
+  else if (wrap && !rows.empty()) {
+    focusRow(direction > 0 ? 0 : rows.size() - 1, direction, false);
+  }
+}
+
+void LazyFormGroup::setFocus(uint8_t flag, Window * from)
+{
+  TRACE_WINDOWS("%s setFocus(%d)", getWindowDebugString("LazyFormGroup").c_str(), flag);
+
+  int index = (from && from != this) ? getRowIndex(from) : -1;
+
+  if (flag == SET_FOCUS_BACKWARD) {
+    focusRow(index >= 0 ? index - 1 : rows.size() - 1, -1, index >= 0);
+  }
+  else {
+    if (flag == SET_FOCUS_FIRST) {
+      clearFocus();
+    }
+    focusRow(index >= 0 ? index + 1 : 0, 1, index >= 0);
+  }
+}
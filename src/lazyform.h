@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include "form.h"
+#include "windowpool.h"
+
+constexpr int LAZY_ROW_NOT_RECYCLED = -1;
+
+// A form page whose rows are only described up front (a height and a
+// factory), and built when they scroll into view or get the focus.
+// Rows leaving the view are deleted, or kept in a pool for the next row
+// of the same type.
+class LazyFormGroup: public FormGroup
+{
+  public:
+    // the factory returns the row window, built with parent as parent,
+    // or the recycled window of the same type bound to the row again
+    typedef std::function<Window * (FormGroup * parent, const rect_t & rect, Window * recycled)> RowFactory;
+
+    LazyFormGroup(Window * parent, const rect_t & rect, WindowFlags windowflags = 0) :
+      FormGroup(parent, rect, windowflags | FORM_FORWARD_FOCUS)
+    {
+    }
+
+#if defined(DEBUG_WINDOWS)
+    std::string getName() const override
+    {
+      return "LazyFormGroup";
+    }
+#endif
+
+    void deleteLater(bool detach = true, bool trash = true) override // NOLINT(google-default-arguments)
+    {
+      if (_deleted)
+        return;
+
+      clear();
+      FormGroup::deleteLater(detach, trash);
+    }
+
+    void addRow(coord_t height, RowFactory factory, int type = LAZY_ROW_NOT_RECYCLED);
+
+    size_t getRowsCount() const
+    {
+      return rows.size();
+    }
+
+    // the row window, nullptr if it isn't built
+    Window * getRowWindow(size_t index) const
+    {
+      return rows[index].window;
+    }
+
+    void clear();
+
+    // row windows link themselves, the chain is rebuilt when rows are built or released
+    void addField(FormField * field, bool front = false) override
+    {
+    }
+
+    void removeField(FormField * field) override
+    {
+    }
+
+    void setFocus(uint8_t flag = SET_FOCUS_DEFAULT, Window * from = nullptr) override;
+
+    void setScrollPositionY(coord_t value) override
+    {
+      FormGroup::setScrollPositionY(value);
+      updateRows();
+    }
+
+    // Window::setHeight() isn't virtual, the resizes done through a Window
+    // pointer are caught by checkEvents()
+    void setHeight(coord_t value)
+    {
+      FormGroup::setHeight(value);
+      updateRows();
+    }
+
+    void checkEvents() override;
+
+  protected:
+    struct Row {
+      coord_t top;
+      coord_t height;
+      int type;
+      RowFactory factory;
+      Window * window;
+    };
+
+    std::vector<Row> rows;
+    // indexes of the built rows, sorted
+    std::vector<uint32_t> built;
+    WindowPool pool;
+    coord_t rowsHeight = 0;
+    // what the rows were last updated for
+    coord_t visibleTop = 0;
+    coord_t visibleBottom = 0;
+    int focusedRow = -1;
+
+    void getVisibleRange(coord_t & top, coord_t & bottom) const;
+    int getRowIndex(Window * window) const;
+    Window * buildRow(uint32_t index);
+    void releaseRow(uint32_t index);
+    void focusRow(int index, int direction, bool wrap);
+    void updateRows();
+    void linkRows();
+};
@@ -67,6 +67,36 @@ struct rect_t
   {
     return left() <= other.left() && right() >= other.right() && top() <= other.top() && bottom() >= other.bottom();
   }
+
+  bool intersects(const rect_t & other) const
+  {
+    return left() < other.right() && right() > other.left() && top() < other.bottom() && bottom() > other.top();
+  }
+
+  rect_t intersection(const rect_t & other) const
+  {
+    coord_t left = this->x > other.x ? this->x : other.x;
+    coord_t top = this->y > other.y ? this->y : other.y;
+    coord_t right = this->right() < other.right() ? this->right() : other.right();
+    coord_t bottom = this->bottom() < other.bottom() ? this->bottom() : other.bottom();
+    if (right <= left || bottom <= top)
+      return {0, 0, 0, 0};
+    return {left, top, right - left, bottom - top};
+  }
+
+  rect_t boundingRect(const rect_t & other) const
+  {
+    coord_t left = this->x < other.x ? this->x : other.x;
+    coord_t top = this->y < other.y ? this->y : other.y;
+    coord_t right = this->right() > other.right() ? this->right() : other.right();
+    coord_t bottom = this->bottom() > other.bottom() ? this->bottom() : other.bottom();
+    return {left, top, right - left, bottom - top};
+  }
+
+  int32_t area() const
+  {
+    return int32_t(w) * h;
+  }
 };
 
 static const rect_t nullRect = {0, 0, 0, 0};
@@ -17,6 +17,7 @@
  * Lesser General Public License for more details.
  */
 
+#include <algorithm>
 #include "mainwindow.h"
 #include "keyboard_base.h"
 
@@ -25,6 +26,28 @@
 #endif
 
 MainWindow * MainWindow::_instance = nullptr;
+TaskQueue<std::function<void()>, POSTED_TASKS_MAX> MainWindow::postedTasks;
+
+bool postToMainWindow(std::function<void()> task)
+{
+  return MainWindow::post(std::move(task));
+}
+
+bool MainWindow::postInvalidate(const rect_t & rect)
+{
+  return post([=]() {
+    MainWindow::instance()->invalidate(rect);
+  });
+}
+
+void MainWindow::runPostedTasks()
+{
+  // bounded, the producers can't keep the UI thread here
+  std::function<void()> task;
+  for (uint32_t i = 0; i < POSTED_TASKS_MAX && postedTasks.pop(task); i++) {
+    task();
+  }
+}
 
 #if defined(HARDWARE_TOUCH)
 TouchState touchState;
@@ -84,6 +107,14 @@ void MainWindow::checkEvents()
       touchState = newTouchState;
     touchState.lastDeltaX = lastDeltaX;
     touchState.lastDeltaY = lastDeltaY;
+
+    auto now = ticksNow();
+    if (newTouchState.event == TE_DOWN)
+      gesture.start(newTouchState.x, newTouchState.y, now);
+    else if (newTouchState.event == TE_SLIDE)
+      gesture.addSample(newTouchState.x, newTouchState.y, now);
+    else if (newTouchState.event == TE_SLIDE_END)
+      gesture.startFling(now);
   }
 
   TouchEnableState currentState = touchEnableState;
@@ -125,39 +156,44 @@ void MainWindow::checkEvents()
   if (touchState.event == TE_DOWN) {
     onTouchStart(touchState.x + scrollPositionX, touchState.y + scrollPositionY);
     slidingWindow = nullptr;
+    slideTarget = nullptr;
   }
   else if (touchState.event == TE_UP) {
     touchState.event = TE_NONE;
     onTouchEnd(touchState.startX + scrollPositionX, touchState.startY + scrollPositionY);
   }
   else if (touchState.event == TE_SLIDE) {
-    if (touchState.deltaX || touchState.deltaY) {
-      onTouchSlide(touchState.x, touchState.y, touchState.startX, touchState.startY, touchState.deltaX, touchState.deltaY);
-      touchState.lastDeltaX = touchState.deltaX;
-      touchState.lastDeltaY = touchState.deltaY;
-      touchState.deltaX = 0;
-      touchState.deltaY = 0;
+    // the deltas of the panel are replaced by the ones of the gesture, taken at the frame time
+    coord_t deltaX, deltaY;
+    gesture.getSlideDelta(ticksNow(), deltaX, deltaY);
+    if (deltaX || deltaY) {
+      if (!forwardSlideToTarget(touchState.x, touchState.y, touchState.startX, touchState.startY, deltaX, deltaY)) {
+        onTouchSlide(touchState.x, touchState.y, touchState.startX, touchState.startY, deltaX, deltaY);
+      }
+      touchState.lastDeltaX = deltaX;
+      touchState.lastDeltaY = deltaY;
     }
+    touchState.deltaX = 0;
+    touchState.deltaY = 0;
   }
   else if (touchState.event == TE_SLIDE_END && slidingWindow) {
-    if (touchState.lastDeltaX > SLIDE_SPEED_REDUCTION)
-      touchState.lastDeltaX -= SLIDE_SPEED_REDUCTION;
-    else if (touchState.lastDeltaX < -SLIDE_SPEED_REDUCTION)
-      touchState.lastDeltaX += SLIDE_SPEED_REDUCTION;
-    else
-      touchState.lastDeltaX = 0;
-    if (touchState.lastDeltaY > SLIDE_SPEED_REDUCTION)
-      touchState.lastDeltaY -= SLIDE_SPEED_REDUCTION;
-    else if (touchState.lastDeltaY < -SLIDE_SPEED_REDUCTION)
-      touchState.lastDeltaY += SLIDE_SPEED_REDUCTION;
-    else
-      touchState.lastDeltaY = 0;
-    
+    coord_t deltaX, deltaY;
+    bool flinging = gesture.stepFling(ticksNow(), deltaX, deltaY);
+
     Window::capturedWindow = nullptr;
 
-    onTouchSlide(touchState.x, touchState.y, touchState.startX, touchState.startY, touchState.lastDeltaX, touchState.lastDeltaY);
-    if(touchState.lastDeltaX == 0 && touchState.lastDeltaY == 0)
+    if (deltaX || deltaY) {
+      // lastDeltaX/Y stay non null until the fling stops, the pages snap afterwards
+      touchState.lastDeltaX = deltaX;
+      touchState.lastDeltaY = deltaY;
+      if (!forwardSlideToTarget(touchState.x, touchState.y, touchState.startX, touchState.startY, deltaX, deltaY)) {
+        onTouchSlide(touchState.x, touchState.y, touchState.startX, touchState.startY, deltaX, deltaY);
+      }
+    }
+    if (!flinging)
     {
+      touchState.lastDeltaX = 0;
+      touchState.lastDeltaY = 0;
       touchState.event = TE_NONE;
       slidingWindow = nullptr;
     }
@@ -175,50 +211,192 @@ void MainWindow::checkEvents()
 
 void MainWindow::invalidate(const rect_t & rect)
 {
-  if (invalidatedRect.w) {
-    auto left = limit<coord_t>(0, rect.left(), invalidatedRect.left());
-    auto right = limit<coord_t>(invalidatedRect.right(), rect.right(), LCD_W);
-    auto top = limit<coord_t>(0, rect.top(), invalidatedRect.top());
-    auto bottom = limit<coord_t>(rect.bottom(), invalidatedRect.bottom(), LCD_H);
-    invalidatedRect = {left, top, right - left, bottom - top};
+  auto left = max<coord_t>(0, rect.left());
+  auto right = min<coord_t>(LCD_W, rect.right());
+  auto top = max<coord_t>(0, rect.top());
+  auto bottom = min<coord_t>(LCD_H, rect.bottom());
+  if (left >= right || top >= bottom)
+    return;
+
+  rect_t area = {left, top, right - left, bottom - top};
+
+  // merge the overlapping rects, they are kept disjoint
+  for (uint8_t i = 0; i < invalidatedRectsCount;) {
+    if (invalidatedRects[i].intersects(area)) {
+      area = area.boundingRect(invalidatedRects[i]);
+      invalidatedRects[i] = invalidatedRects[--invalidatedRectsCount];
+      i = 0;
+    }
+    else {
+      i++;
+    }
   }
-  else {
-    invalidatedRect = rect;
+
+  if (invalidatedRectsCount == INVALIDATED_RECTS_MAX) {
+    // no room left, merge with the rect which grows the least
+    uint8_t best = 0;
+    int bestGrowth = INT32_MAX;
+    for (uint8_t i = 0; i < invalidatedRectsCount; i++) {
+      auto bounding = area.boundingRect(invalidatedRects[i]);
+      int growth = bounding.w * bounding.h - invalidatedRects[i].w * invalidatedRects[i].h;
+      if (growth < bestGrowth) {
+        best = i;
+        bestGrowth = growth;
+      }
+    }
+    area = area.boundingRect(invalidatedRects[best]);
+    invalidatedRects[best] = invalidatedRects[--invalidatedRectsCount];
+    invalidate(area);
+    return;
   }
+
+  invalidatedRects[invalidatedRectsCount++] = area;
 }
 
-bool MainWindow::refresh()
+bool MainWindow::blit(const rect_t & area, coord_t dx, coord_t dy)
+{
+  if (blitsCount == BLITS_MAX)
+    return false;
+
+  // the damage recorded before has to be known
+  resolveInvalidations();
+
+  // the tiles of a frame in progress are painted from a newer state than
+  // the one on screen, moving the pixels would apply the change twice
+  if (isFrameInProgress())
+    return false;
+
+  const rect_t screen = {0, 0, LCD_W, LCD_H};
+  if (!screen.contains(area) || !screen.contains({area.x + dx, area.y + dy, area.w, area.h}))
+    return false;
+
+  // pixels waiting for a repaint can't be moved, they would stay wrong at their new position
+  for (uint8_t i = 0; i < invalidatedRectsCount; i++) {
+    if (invalidatedRects[i].intersects(area))
+      return false;
+  }
+
+  blits[blitsCount++] = {area, dx, dy};
+  return true;
+}
+
+static rect_t getAbsoluteRect(const Window * window)
+{
+  rect_t result = window->getRect();
+  for (auto parent = window->getParent(); parent; parent = parent->getParent()) {
+    result.x += parent->left() - parent->getScrollPositionX();
+    result.y += parent->top() - parent->getScrollPositionY();
+  }
+  return result;
+}
+
+void MainWindow::startFrame()
 {
-  if (invalidatedRect.w) {
-    if (invalidatedRect.x > 0 || invalidatedRect.y > 0 || invalidatedRect.w < LCD_W || invalidatedRect.h < LCD_H) {
-      TRACE_WINDOWS("Refresh rect: left=%d top=%d width=%d height=%d", invalidatedRect.left(), invalidatedRect.top(), invalidatedRect.w, invalidatedRect.h);
-      lcdCopy(lcd->getData(), lcdFront->getData());
+  const rect_t & first = invalidatedRects[0];
+  if (invalidatedRectsCount != 1 || first.x > 0 || first.y > 0 || first.w < LCD_W || first.h < LCD_H) {
+    lcdCopy(lcd->getData(), lcdFront->getData());
+    lcd->reset();
+    for (uint8_t i = 0; i < blitsCount; i++) {
+      const auto & blit = blits[i];
+      TRACE_WINDOWS("Blit rect: left=%d top=%d width=%d height=%d dx=%d dy=%d", blit.rect.left(), blit.rect.top(), blit.rect.w, blit.rect.h, blit.dx, blit.dy);
+      lcd->moveRect(blit.rect.x, blit.rect.y, blit.rect.w, blit.rect.h, blit.dx, blit.dy);
+    }
+  }
+  else {
+    TRACE_WINDOWS("Refresh full screen");
+  }
+
+  refreshTiles.clear();
+  nextRefreshTile = 0;
+
+  for (uint8_t i = 0; i < invalidatedRectsCount; i++) {
+    const auto & invalidatedRect = invalidatedRects[i];
+    if (refreshBudget) {
+      // split in bands so that a big rect can be spread over several calls
+      for (coord_t y = invalidatedRect.top(); y < invalidatedRect.bottom(); y += REFRESH_TILE_HEIGHT) {
+        refreshTiles.push_back({invalidatedRect.x, y, invalidatedRect.w, min(REFRESH_TILE_HEIGHT, invalidatedRect.bottom() - y)});
+      }
     }
     else {
-      TRACE_WINDOWS("Refresh full screen");
+      refreshTiles.push_back(invalidatedRect);
     }
-    lcd->setOffset(0, 0);
-    lcd->setClippingRect(invalidatedRect.left(), invalidatedRect.right(), invalidatedRect.top(), invalidatedRect.bottom());
-    fullPaint(lcd);
-    invalidatedRect.w = 0;
-    return true;
   }
-  else {
-    return false;
+
+  if (refreshBudget && Window::getFocus()) {
+    const rect_t focusRect = getAbsoluteRect(Window::getFocus());
+    std::stable_sort(refreshTiles.begin(), refreshTiles.end(), [&](const rect_t & a, const rect_t & b) {
+      bool aFocused = a.intersects(focusRect);
+      bool bFocused = b.intersects(focusRect);
+      if (aFocused != bFocused)
+        return aFocused;
+      return a.area() < b.area();
+    });
+  }
+
+  invalidatedRectsCount = 0;
+  blitsCount = 0;
+}
+
+bool MainWindow::refresh()
+{
+  resolveInvalidations();
+
+  if (!isFrameInProgress()) {
+    if (!invalidatedRectsCount && !blitsCount) {
+      return false;
+    }
+    startFrame();
+  }
+
+  // also needed in the middle of a frame, windows may have been deleted since the previous call
+  if (renderListVersion != layoutVersion) {
+    renderList.clear();
+    buildRenderList(renderList, 0, 0, rect);
+    renderListVersion = layoutVersion;
+    TRACE_WINDOWS("Render list rebuilt: %d windows", int(renderList.size()));
+  }
+
+  auto start = ticksNow();
+  size_t first = nextRefreshTile;
+  while (isFrameInProgress()) {
+    if (refreshBudget && nextRefreshTile > first && ticksNow() - start >= refreshBudget) {
+      TRACE_WINDOWS("Refresh budget spent, %d tiles left", int(refreshTiles.size() - nextRefreshTile));
+      return false;
+    }
+    const auto & tile = refreshTiles[nextRefreshTile++];
+    TRACE_WINDOWS("Refresh rect: left=%d top=%d width=%d height=%d", tile.left(), tile.top(), tile.w, tile.h);
+    paintRenderList(lcd, renderList, tile);
   }
+
+  return true;
 }
 
 void MainWindow::run(bool trash)
 {
   auto start = ticksNow();
+  lastRunTime = start;
+  animating = false;
+
+  runPostedTasks();
+
+  timerWheel.advance(start);
 
   checkEvents();
 
+  resolveInvalidations();
+
   if (trash) {
     emptyTrash();
   }
-  
-  if (refresh()) {
+
+  if (pipelined) {
+    // while the previous frame is not presented the invalidated rect is kept
+    // for the next call, events keep being processed in the meantime
+    if (!hasPendingFrame() && refresh()) {
+      frameState.store(FRAME_READY, std::memory_order_release);
+    }
+  }
+  else if (refresh()) {
     lcdRefresh();
   }
 
@@ -227,3 +405,44 @@ void MainWindow::run(bool trash)
     TRACE_WINDOWS("MainWindow::run took %dms", (ticksNow() - start) / SYSTEM_TICKS_1MS);
   }
 }
+
+bool MainWindow::getNextDeadline(uint32_t & deadline) const
+{
+  if (!trash.empty() || !postedTasks.empty() || (needsRefresh() && !(pipelined && hasPendingFrame()))) {
+    deadline = ticksNow();
+    return true;
+  }
+
+  bool polling = (subtreeInterest & (EVENT_INTEREST_DYNAMIC | EVENT_INTEREST_TIMERS)) || animating;
+#if defined(HARDWARE_TOUCH)
+  // a touch in progress or a kinetic scrolling
+  polling = polling || touchState.event != TE_NONE;
+#endif
+
+  uint32_t expiry;
+  if (timerWheel.getNextExpiry(expiry)) {
+    if (polling && int32_t(lastRunTime + pollPeriod - expiry) < 0) {
+      expiry = lastRunTime + pollPeriod;
+    }
+    deadline = expiry;
+    return true;
+  }
+
+  if (polling) {
+    deadline = lastRunTime + pollPeriod;
+    return true;
+  }
+
+  return false;
+}
+
+bool MainWindow::present()
+{
+  if (!hasPendingFrame()) {
+    return false;
+  }
+
+  lcdRefresh();
+  frameState.store(FRAME_IDLE, std::memory_order_release);
+  return true;
+}
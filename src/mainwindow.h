@@ -20,24 +20,35 @@
 #pragma once
 
 #include <utility>
+#include <atomic>
 #include "layer.h"
 #include "bitmapbuffer.h"
+#include "timer.h"
+#include "gesture.h"
+#include "taskqueue.h"
+
+constexpr uint8_t INVALIDATED_RECTS_MAX = 4;
+constexpr uint8_t BLITS_MAX = 4;
+constexpr coord_t REFRESH_TILE_HEIGHT = 32;
 
 class MainWindow: public Window
 {
   protected:
     // singleton
     MainWindow():
-      Window(nullptr, {0, 0, LCD_W, LCD_H}),
-      invalidatedRect(rect)
+      Window(nullptr, {0, 0, LCD_W, LCD_H})
     {
+      invalidatedRects[0] = rect;
+      invalidatedRectsCount = 1;
+      // nothing to poll here, the touch events are read on input
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
       Layer::push(this);
     }
 
   public:
     ~MainWindow() override
     {
-      children.clear();
+      removeChildren();
     }
 
     static MainWindow * instance()
@@ -85,21 +96,136 @@ class MainWindow: public Window
 
     bool needsRefresh() const
     {
-      return invalidatedRect.w > 0;
+      return invalidatedRectsCount > 0 || blitsCount > 0 || isFrameInProgress() || !invalidationQueue.empty();
     }
 
+    // returns true when a complete frame is ready to be presented
     bool refresh();
 
     void run(bool trash=true);
 
+    // Scheduling help for the host loop: returns false when the UI is idle,
+    // run() then only needs to be called on input (or after an invalidate()
+    // from outside). Otherwise deadline receives the ticksNow() value at which
+    // run() has work to do: immediately for a pending refresh, after the poll
+    // period while windows poll their data (EVENT_INTEREST_DYNAMIC), refresh
+    // always or animate, and otherwise at the expiry of the next timer.
+    bool getNextDeadline(uint32_t & deadline) const;
+
+    TimerWheel & getTimerWheel()
+    {
+      return timerWheel;
+    }
+
+    // Entry points for the background threads. The tasks are run from the UI
+    // thread at the start of run(), in the order they were posted. The host
+    // loop has to be woken by the producer if it sleeps until the deadline
+    static bool post(std::function<void()> task)
+    {
+      return postedTasks.push(std::move(task));
+    }
+
+    // rect is in screen coordinates
+    static bool postInvalidate(const rect_t & rect);
+
+    void setPollPeriod(uint32_t ms)
+    {
+      pollPeriod = ms * SYSTEM_TICKS_1MS;
+    }
+
+    // In pipelined mode run() only produces the frames (events + paint into
+    // the back buffer), present() is expected to be called from a dedicated
+    // render thread which waits for the LCD and swaps the buffers. Input
+    // handling of the next frame then overlaps with the presentation of the
+    // previous one. The mode should only be changed when the render thread
+    // is not running.
+    void setPipelined(bool value)
+    {
+      // a produced frame has no invalidated rects left, it is presented now
+      // rather than dropped
+      present();
+      pipelined = value;
+    }
+
+    bool isPipelined() const
+    {
+      return pipelined;
+    }
+
+    bool hasPendingFrame() const
+    {
+      return frameState.load(std::memory_order_acquire) == FRAME_READY;
+    }
+
+    bool present();
+
+    // In progressive mode refresh() stops painting once the budget is spent
+    // and resumes with the remaining tiles on the next call, so that events
+    // keep being processed during heavy repaints. The focused window and the
+    // small tiles are painted first. Only complete frames are presented.
+    // A budget of 0 disables the mode.
+    void setRefreshBudget(uint32_t ms)
+    {
+      refreshBudget = ms * SYSTEM_TICKS_1MS;
+    }
+
+    bool isFrameInProgress() const
+    {
+      return nextRefreshTile < refreshTiles.size();
+    }
+
   protected:
     static MainWindow * _instance;
     static void emptyTrash();
-    rect_t invalidatedRect;
+
+    // the invalidated area is kept as a few disjoint rects so that distant
+    // updates (a scrolled strip and a clock for instance) are painted separately
+    rect_t invalidatedRects[INVALIDATED_RECTS_MAX];
+    uint8_t invalidatedRectsCount = 0;
+
+    // areas of the screen moved before painting (scrolling)
+    struct Blit
+    {
+      rect_t rect;
+      coord_t dx;
+      coord_t dy;
+    };
+    Blit blits[BLITS_MAX];
+    uint8_t blitsCount = 0;
+
+    bool blit(const rect_t & area, coord_t dx, coord_t dy) override;
+
+    // rebuilt only when the layout of the windows tree has changed
+    std::vector<RenderEntry> renderList;
+    uint32_t renderListVersion = 0;
+
+    // the tiles of the frame being painted
+    std::vector<rect_t> refreshTiles;
+    size_t nextRefreshTile = 0;
+    uint32_t refreshBudget = 0;
+
+    void startFrame();
+
     const char * shutdown = nullptr;
+
+    uint32_t pollPeriod = 10 * SYSTEM_TICKS_1MS;
+    uint32_t lastRunTime = 0;
+    TimerWheel timerWheel;
+
+    static TaskQueue<std::function<void()>, POSTED_TASKS_MAX> postedTasks;
+
+    void runPostedTasks();
+
+    enum FrameState: uint8_t {
+      FRAME_IDLE,  // the back buffer is owned by the UI thread
+      FRAME_READY  // the back buffer is owned by the render thread until presented
+    };
+    bool pipelined = false;
+    std::atomic<uint8_t> frameState { FRAME_IDLE };
 #if defined(HARDWARE_TOUCH)
     bool lastTouchState = false;
     bool _touchEventOccured = false;
+    GestureTracker gesture;
 
     enum TouchEnableState {
     	TouchOn,
@@ -20,14 +20,15 @@
 #include "menu.h"
 #include "font.h"
 #include "theme.h"
+#include <algorithm>
 
 
 // ensure index is in range and also handle wrapping index
 int MenuBody::rangeCheck(int index)
 {
     if (index < 0) 
-      index = lines.size() - 1;
-    else if (index > (signed)lines.size() - 1)
+      index = count() - 1;
+    else if (index > count() - 1)
       index = 0;
 
     return index;
@@ -36,10 +37,8 @@ int MenuBody::rangeCheck(int index)
 void MenuBody::setIndex(int index)
 {
   selectedIndex = index;
-  // calculate the correct scroll postion based on there being separators
-  int scrollY = 0;
-  for (int i = 0; i < selectedIndex; i++)
-    scrollY += lines[i].lineHeight();
+  // the scroll position takes the separators heights into account
+  coord_t scrollY = getLineTop(selectedIndex);
 
   if (innerHeight > height()) {
     setScrollPositionY(scrollY - 3 * MENUS_LINE_HEIGHT);
@@ -51,23 +50,91 @@ void MenuBody::setIndex(int index)
 void MenuBody::select(int index)
 {
   // adjust the selection based on separators
-  for (int i = 0; i <= index; i++) {
-    if (lines[i].isSeparator)
-      index++;
-    index = rangeCheck(index);
+  if (separatorsCount > 0) {
+    for (int i = 0; i <= index && i < (int)lines.size(); i++) {
+      if (lines[i].isSeparator)
+        index++;
+    }
   }
 
-  setIndex(index);
+  if (filtering) {
+    // the line may be filtered out
+    auto it = std::lower_bound(filtered.begin(), filtered.end(), uint32_t(index));
+    if (it == filtered.end() || *it != uint32_t(index))
+      return;
+    index = it - filtered.begin();
+  }
+
+  setIndex(rangeCheck(index));
+}
+
+void MenuBody::setFilter(const std::vector<uint32_t> & indexes)
+{
+  filtered.clear();
+  for (auto index: indexes) {
+    if (index < (uint32_t)(provider ? provider->count : lines.size()) && !(provider == nullptr && lines[index].isSeparator)) {
+      filtered.push_back(index);
+    }
+  }
+  filtering = true;
+  selectedIndex = 0;
+  setInnerHeight(getLinesHeight());
+  setScrollPositionY(0);
+  invalidate();
+}
+
+void MenuBody::clearFilter()
+{
+  if (filtering) {
+    int index = selectedIndex < (int)filtered.size() ? filtered[selectedIndex] : 0;
+    filtering = false;
+    filtered.clear();
+    setInnerHeight(getLinesHeight());
+    setIndex(index);
+  }
+}
+
+int MenuBody::getLineAt(coord_t y) const
+{
+  if (y < 0)
+    return 0;
+
+  if (provider || filtering)
+    return min<int>(count(), y / MENUS_LINE_HEIGHT);
+
+  return std::upper_bound(lineTops.begin(), lineTops.end(), y) - lineTops.begin() - 1;
+}
+
+void MenuBody::pressLine(int index)
+{
+  index = getLineIndex(index);
+  if (provider) {
+    if (provider->onPress) {
+      provider->onPress(index);
+    }
+  }
+  else {
+    lines[index].onPress();
+  }
 }
 
-void MenuBody::selectNext(MENU_DIRECTION direction)
+void MenuBody::setLineProvider(unsigned count, std::function<std::string(unsigned)> getText, std::function<void(unsigned)> onPress, std::function<bool(unsigned)> isChecked)
 {
-  // look for the next non separator line
-  int index = selectedIndex + direction;
-  index = rangeCheck(index);
-  while (lines[index].isSeparator) {
-    index += direction;
-    index = rangeCheck(index);
+  removeLines();
+  provider = new LineProvider{count, std::move(getText), std::move(onPress), std::move(isChecked)};
+  selectedIndex = 0;
+}
+
+void MenuBody::selectNext(MENU_DIRECTION direction, uint16_t count)
+{
+  // look for the next non separator line, count times
+  int index = selectedIndex;
+  for (uint16_t i = 0; i < count; i++) {
+    index = rangeCheck(index + direction);
+    while (isSeparator(index)) {
+      index += direction;
+      index = rangeCheck(index);
+    }
   }
 
   setIndex(index);
@@ -75,24 +142,46 @@ void MenuBody::selectNext(MENU_DIRECTION direction)
 
 
 #if defined(HARDWARE_KEYS)
+void MenuBody::onInputEvent(const InputEvent & input)
+{
+  if (input.event == EVT_ROTARY_RIGHT || input.event == EVT_ROTARY_LEFT) {
+    // going up from the first line reaches the search field
+    auto searchField = getParentMenu()->searchField;
+    if (searchField && input.event == EVT_ROTARY_LEFT && selectedIndex <= 0) {
+      onKeyPress();
+      searchField->setFocus(SET_FOCUS_DEFAULT);
+      searchField->setEditMode(true);
+      searchField->invalidate();
+      return;
+    }
+    if (count() > 0) {
+      selectNext(input.event == EVT_ROTARY_RIGHT ? DIRECTION_UP : DIRECTION_DOWN, input.count);
+      onKeyPress();
+    }
+  }
+  else {
+    Window::onInputEvent(input);
+  }
+}
+
 void MenuBody::onEvent(event_t event)
 {
   TRACE_WINDOWS("%s received event 0x%X", getWindowDebugString().c_str(), event);
 
   if (event == EVT_ROTARY_RIGHT) {
-    if (!lines.empty()) {
+    if (count() > 0) {
       selectNext(DIRECTION_UP);
       onKeyPress();
     }
   }
   else if (event == EVT_ROTARY_LEFT) {
-    if (!lines.empty()) {
+    if (count() > 0) {
       selectNext(DIRECTION_DOWN);
       onKeyPress();
     }
   }
   else if (event == EVT_KEY_BREAK(KEY_ENTER)) {
-    if (!lines.empty()) {
+    if (count() > 0) {
       onKeyPress();
       if (selectedIndex < 0) {
         select(0);
@@ -100,12 +189,12 @@ void MenuBody::onEvent(event_t event)
       else {
         Menu * menu = getParentMenu();
         if (menu->multiple) {
-          lines[selectedIndex].onPress();
+          pressLine(selectedIndex);
           menu->invalidate();
         }
         else {
           menu->deleteLater();
-          lines[selectedIndex].onPress();
+          pressLine(selectedIndex);
         }
       }
     }
@@ -128,36 +217,25 @@ bool MenuBody::onTouchEnd(coord_t /*x*/, coord_t y)
 {
   Menu * menu = getParentMenu();
 
-  int index = 0;
-
-  // dynamically find the selected element based on variable line heights
-  coord_t yAccumulator = 0;
-  for (int i = 0; i < (signed)lines.size(); i++) {
-    if (y >= yAccumulator && y <= yAccumulator + lines[i].lineHeight()) {
-      index = i;
-      break;
-    }
-    yAccumulator += lines[i].lineHeight();
-  }
+  // the line heights are variable
+  int index = getLineAt(y);
 
   // dont allow selecting separators
-  if (lines[index].isSeparator)
+  if (index >= count() || isSeparator(index))
     return false;
 
-  if (index < (int)lines.size()) {
-    onKeyPress();
-    if (menu->multiple) {
-      if (selectedIndex == index)
-        lines[index].onPress();
-      else
-        setIndex(index);
-      menu->invalidate();
-    }
-    else {
+  onKeyPress();
+  if (menu->multiple) {
+    if (selectedIndex == index)
+      pressLine(index);
+    else
       setIndex(index);
-      menu->deleteLater();
-      lines[index].onPress();
-    }
+    menu->invalidate();
+  }
+  else {
+    setIndex(index);
+    menu->deleteLater();
+    pressLine(index);
   }
 
   return true;
@@ -168,13 +246,20 @@ void MenuBody::paint(BitmapBuffer * dc)
 {
   dc->clear(COLOR_THEME_PRIMARY2);
 
-  int y = 0;
-  for (int i = 0; i < (signed)lines.size(); i++) {
-    auto& line = lines[i];
+  // only the lines inside the clipping rect
+  coord_t xmin, xmax, ymin, ymax;
+  dc->getClippingRect(xmin, xmax, ymin, ymax);
+  ymin -= dc->getOffsetY();
+  ymax -= dc->getOffsetY();
+
+  Menu* menu = getParentMenu();
+  for (int i = getLineAt(ymin); i < count() && getLineTop(i) < ymax; i++) {
+    coord_t y = getLineTop(i);
+    bool separator = isSeparator(i);
     LcdFlags flags = COLOR_THEME_PRIMARY3 | MENU_FONT;
 
     // draw selection if appropriate
-    if (selectedIndex == i && ! line.isSeparator) {
+    if (selectedIndex == i && !separator) {
       flags = COLOR_THEME_PRIMARY2 | MENU_FONT;
       if (COLOR_THEME_FOCUS != COLOR_THEME_PRIMARY2) {
         dc->drawSolidFilledRect(0, y, width(),
@@ -182,7 +267,21 @@ void MenuBody::paint(BitmapBuffer * dc)
       }
     }
 
-    if (line.isSeparator) {
+    if (provider) {
+      auto text = provider->getText(getLineIndex(i));
+      dc->drawText(10,
+                   y + (MENUS_LINE_HEIGHT - getFontHeight(MENU_FONT)) / 2,
+                   text.empty() ? "---" : text.c_str(), flags);
+      if (menu->multiple && provider->isChecked) {
+        theme->drawCheckBox(dc, provider->isChecked(getLineIndex(i)), width() - 35,
+                            y + (MENUS_LINE_HEIGHT - 20) / 2,
+                            0);
+      }
+      continue;
+    }
+
+    auto& line = lines[getLineIndex(i)];
+    if (separator) {
       dc->drawHorizontalLine(5, y + MENUS_SEPARATOR_HEIGHT / 2, width() - 10, 255, COLOR_THEME_SECONDARY1);
     } else if (line.drawLine) {
       line.drawLine(dc, 0, y, COLOR_THEME_PRIMARY3);
@@ -193,14 +292,11 @@ void MenuBody::paint(BitmapBuffer * dc)
                    text[0] == '\0' ? "---" : text, flags);
     }
 
-    Menu* menu = getParentMenu();
     if (menu->multiple && line.isChecked) {
       theme->drawCheckBox(dc, line.isChecked(), width() - 35,
                           y + (MENUS_LINE_HEIGHT - 20) / 2,
                           0);
     }
-
-    y += line.lineHeight();
   }
 }
 
@@ -236,24 +332,82 @@ Menu::Menu(Window * parent, bool multiple):
 
 void Menu::updatePosition()
 {
-  // calcualte the correct menu height given that the line heights are variable
-  coord_t height = 0;
-  for (int i = 0; i < (signed)content->body.lines.size(); i++)
-    height += content->body.lines[i].lineHeight();
+  // the line heights are variable
+  coord_t height = content->body.getLinesHeight();
+  coord_t searchHeight = searchField ? MENUS_LINE_HEIGHT : 0;
 
   if (!toolbar) {
     // there is no navigation bar at the left, we may center the window on screen
     auto headerHeight = content->title.empty() ? 0 : POPUP_HEADER_HEIGHT;
     auto bodyHeight = limit<coord_t>(MENUS_MIN_HEIGHT, height, MENUS_MAX_HEIGHT);
-    content->setTop((LCD_H - headerHeight - bodyHeight) / 2 + MENUS_OFFSET_TOP);
-    content->setHeight(headerHeight + bodyHeight);
-    content->body.setTop(headerHeight);
+    content->setTop((LCD_H - headerHeight - searchHeight - bodyHeight) / 2 + MENUS_OFFSET_TOP);
+    content->setHeight(headerHeight + searchHeight + bodyHeight);
+    content->body.setTop(headerHeight + searchHeight);
     content->body.setHeight(bodyHeight);
   }
+  else if (searchField) {
+    content->body.setTop(searchHeight);
+    content->body.setHeight(content->height() - searchHeight);
+  }
+
+  if (searchField) {
+    searchField->setTop(content->body.top() - searchHeight);
+  }
 
   content->body.setInnerHeight(height);
 }
 
+void MenuSearchField::checkEvents()
+{
+  TextEdit::checkEvents();
+
+  // the spaces at the end come from the edition
+  std::string value(query);
+  value.erase(value.find_last_not_of(' ') + 1);
+  if (value != lastQuery) {
+    lastQuery = value;
+    menu->setQuery(value);
+  }
+}
+
+#if defined(HARDWARE_KEYS)
+void MenuSearchField::onEvent(event_t event)
+{
+  // once the query is entered, the rotary and EXIT go back to the lines
+  if (!editMode && (event == EVT_ROTARY_RIGHT || event == EVT_KEY_BREAK(KEY_EXIT))) {
+    onKeyPress();
+    menu->setFocusBody();
+    return;
+  }
+
+  TextEdit::onEvent(event);
+}
+#endif
+
+void Menu::setSearchHandler(std::function<void(const std::string &, bool, std::vector<uint32_t> &)> handler)
+{
+  searchHandler = std::move(handler);
+  if (!searchField) {
+    searchField = new MenuSearchField(content, {0, 0, content->width(), MENUS_LINE_HEIGHT}, this);
+    updatePosition();
+  }
+}
+
+void Menu::setQuery(const std::string & value)
+{
+  if (value.empty() || !searchHandler) {
+    query.clear();
+    content->body.clearFilter();
+    return;
+  }
+
+  // the lines found for the previous keystroke are narrowed down
+  bool narrow = !query.empty() && value.find(query) != std::string::npos;
+  query = value;
+  searchHandler(query, narrow, searchResult);
+  content->body.setFilter(searchResult);
+}
+
 void Menu::setTitle(std::string text)
 {
   content->setTitle(std::move(text));
@@ -284,6 +438,12 @@ void Menu::removeLines()
   updatePosition();
 }
 
+void Menu::setLineProvider(unsigned count, std::function<std::string(unsigned)> getText, std::function<void(unsigned)> onPress, std::function<bool(unsigned)> isChecked)
+{
+  content->body.setLineProvider(count, std::move(getText), std::move(onPress), std::move(isChecked));
+  updatePosition();
+}
+
 #if defined(HARDWARE_KEYS)
 void Menu::onEvent(event_t event)
 {
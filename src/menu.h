@@ -21,8 +21,13 @@
 
 #include <vector>
 #include <functional>
+#include <memory>
 #include <utility>
 #include "modal_window.h"
+#include "textedit.h"
+#include "searchindex.h"
+
+constexpr uint8_t MENUS_SEARCH_LENGTH = 32;
 
 class Menu;
 class MenuWindowContent;
@@ -77,6 +82,15 @@ class MenuBody: public Window
       std::function<bool()> isChecked;
   };
 
+  // lines given on demand in place of MenuLine objects, they all have the
+  // same height and no separators
+  struct LineProvider {
+    unsigned count;
+    std::function<std::string(unsigned /*index*/)> getText;
+    std::function<void(unsigned /*index*/)> onPress;
+    std::function<bool(unsigned /*index*/)> isChecked;
+  };
+
   public:
     MenuBody(Window * parent, const rect_t & rect):
       Window(parent, rect, OPAQUE)
@@ -84,6 +98,11 @@ class MenuBody: public Window
       setPageHeight(MENUS_LINE_HEIGHT);
     }
 
+    ~MenuBody() override
+    {
+      delete provider;
+    }
+
 #if defined(DEBUG_WINDOWS)
     std::string getName() const override
     {
@@ -95,21 +114,43 @@ class MenuBody: public Window
 
     int selection() const
     {
-      int index = selectedIndex;
-      for (int i = 0; i < selectedIndex; i++)
-        if (lines[i].isSeparator)
-          index--;
+      if (filtering && selectedIndex >= (int)filtered.size())
+        return -1;
+
+      int index = getLineIndex(selectedIndex);
+      if (separatorsCount > 0) {
+        for (int i = getLineIndex(selectedIndex) - 1; i >= 0; i--)
+          if (lines[i].isSeparator)
+            index--;
+      }
 
       return index;
     }
 
     int count() const
     {
-      return lines.size();
+      if (filtering)
+        return filtered.size();
+      return provider ? provider->count : lines.size();
     }
 
+    // the height of all the lines
+    coord_t getLinesHeight() const
+    {
+      if (filtering || provider)
+        return count() * MENUS_LINE_HEIGHT;
+      return lineTops.back();
+    }
+
+    // only these lines (indexes in ascending order) are shown, without the separators
+    void setFilter(const std::vector<uint32_t> & indexes);
+
+    void clearFilter();
+
 #if defined(HARDWARE_KEYS)
     void onEvent(event_t event) override;
+
+    void onInputEvent(const InputEvent & input) override;
 #endif
 
 #if defined(HARDWARE_TOUCH)
@@ -119,26 +160,39 @@ class MenuBody: public Window
     void addLine(const std::string & text, std::function<void()> onPress, std::function<bool()> isChecked)
     {
       lines.emplace_back(text, std::move(onPress), std::move(isChecked));
+      lineTops.push_back(lineTops.back() + MENUS_LINE_HEIGHT);
       invalidate();
     }
 
     void addCustomLine(std::function<void(BitmapBuffer * /*dc*/, coord_t /*x*/, coord_t /*y*/, LcdFlags /*flags*/)> drawLine, std::function<void()> onPress, std::function<bool()> isChecked)
     {
       lines.emplace_back(std::move(drawLine), std::move(onPress), std::move(isChecked));
+      lineTops.push_back(lineTops.back() + MENUS_LINE_HEIGHT);
       invalidate();
     }
 
     void addSeparator()
     {
       lines.emplace_back(true);
+      lineTops.push_back(lineTops.back() + MENUS_SEPARATOR_HEIGHT);
+      separatorsCount++;
     }
 
     void removeLines()
     {
       lines.clear();
+      lineTops.assign(1, 0);
+      separatorsCount = 0;
+      delete provider;
+      provider = nullptr;
+      filtering = false;
+      filtered.clear();
       invalidate();
     }
 
+    // replaces the lines
+    void setLineProvider(unsigned count, std::function<std::string(unsigned)> getText, std::function<void(unsigned)> onPress, std::function<bool(unsigned)> isChecked = nullptr);
+
     void setCancelHandler(std::function<void()> handler)
     {
       onCancel = std::move(handler);
@@ -147,11 +201,38 @@ class MenuBody: public Window
     void paint(BitmapBuffer * dc) override;
 
   protected:
-    void selectNext(MENU_DIRECTION direction);
+    void selectNext(MENU_DIRECTION direction, uint16_t count = 1);
     int rangeCheck(int);
     void setIndex(int index);
 
+    // the index of the line shown at this position
+    int getLineIndex(int index) const
+    {
+      return filtering ? filtered[index] : index;
+    }
+
+    bool isSeparator(int index) const
+    {
+      return !provider && !filtering && lines[index].isSeparator;
+    }
+
+    coord_t getLineTop(int index) const
+    {
+      return (provider || filtering) ? index * MENUS_LINE_HEIGHT : lineTops[index];
+    }
+
+    // the line at this position, count() when below the lines
+    int getLineAt(coord_t y) const;
+
+    void pressLine(int index);
+
     std::vector<MenuLine> lines;
+    // the top of each line, followed by the height of all the lines
+    std::vector<coord_t> lineTops = {0};
+    int separatorsCount = 0;
+    LineProvider * provider = nullptr;
+    std::vector<uint32_t> filtered;
+    bool filtering = false;
     int selectedIndex = 0;
     std::function<void()> onCancel;
 
@@ -187,6 +268,35 @@ class MenuWindowContent: public ModalWindowContent
     MenuBody body;
 };
 
+class MenuSearchField: public TextEdit
+{
+  public:
+    MenuSearchField(Window * parent, const rect_t & rect, Menu * menu):
+      TextEdit(parent, rect, query, MENUS_SEARCH_LENGTH),
+      menu(menu)
+    {
+    }
+
+#if defined(DEBUG_WINDOWS)
+    std::string getName() const override
+    {
+      return "MenuSearchField";
+    }
+#endif
+
+    // each keystroke narrows the menu lines
+    void checkEvents() override;
+
+#if defined(HARDWARE_KEYS)
+    void onEvent(event_t event) override;
+#endif
+
+  protected:
+    Menu * menu;
+    char query[MENUS_SEARCH_LENGTH + 1] = "";
+    std::string lastQuery;
+};
+
 class Menu: public ModalWindow
 {
   friend class MenuBody;
@@ -234,6 +344,31 @@ class Menu: public ModalWindow
 
     void removeLines();
 
+    // adds a search field, the handler receives the query and gives the
+    // indexes of the lines to show. With narrow, lines holds the result for a
+    // query contained in this one
+    void setSearchHandler(std::function<void(const std::string & /*query*/, bool /*narrow*/, std::vector<uint32_t> & /*lines*/)> handler);
+
+    // the entry n of the index is the line firstLine + n, the lines before
+    // firstLine are never found. The menu keeps the index
+    void setSearchIndex(std::shared_ptr<const SearchIndex> index, uint32_t firstLine = 0)
+    {
+      setSearchHandler([=](const std::string & query, bool narrow, std::vector<uint32_t> & lines) {
+        for (auto & line: lines) {
+          line -= firstLine;
+        }
+        index->search(query, lines, narrow);
+        for (auto & line: lines) {
+          line += firstLine;
+        }
+      });
+    }
+
+    void setQuery(const std::string & query);
+
+    // for long lists, the lines are then given on demand
+    void setLineProvider(unsigned count, std::function<std::string(unsigned)> getText, std::function<void(unsigned)> onPress, std::function<bool(unsigned)> isChecked = nullptr);
+
     unsigned count() const
     {
       return content->body.count();
@@ -268,6 +403,10 @@ class Menu: public ModalWindow
     bool multiple;
     Window * toolbar = nullptr;
     std::function<void()> waitHandler;
+    MenuSearchField * searchField = nullptr;
+    std::function<void(const std::string &, bool, std::vector<uint32_t> &)> searchHandler;
+    std::string query;
+    std::vector<uint32_t> searchResult;
     void updatePosition();
 };
 
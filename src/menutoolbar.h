@@ -65,25 +65,21 @@ class MenuToolbar: public FormGroup {
     {
       if (event == EVT_KEY_BREAK(KEY_PGDN)  || event == EVT_KEY_LONG(KEY_PGDN) || event == EVT_KEY_BREAK(KEY_PGUP)) {
 #if defined(HARDWARE_TOUCH)
-        if (current != children.end()) {
-          static_cast<MenuToolbarButton *>(*current)->onTouchEnd(0,0);
+        if (current >= 0) {
+          static_cast<MenuToolbarButton *>(children[current])->onTouchEnd(0,0);
         }
 #endif
-        current = IS_KEY_LONG(event) || event == EVT_KEY_BREAK(KEY_PGUP) ?
-          current == children.end() ?
-            --current:
-            current == children.begin() ? 
-              children.end() :
-              --current : 
-          current == children.end() ?
-            children.begin() :
-            ++current;
+        int count = children.size();
+        if (IS_KEY_LONG(event) || event == EVT_KEY_BREAK(KEY_PGUP))
+          current = (current < 0 ? count : current) - 1;
+        else
+          current = current + 1 < count ? current + 1 : -1;
 
         if (IS_KEY_LONG(event))
           killEvents(event);
 
-        if (current != children.end()) {
-          auto button = static_cast<MenuToolbarButton *>(*current);
+        if (current >= 0) {
+          auto button = static_cast<MenuToolbarButton *>(children[current]);
 #if defined(HARDWARE_TOUCH)
           button->onTouchEnd(0,0);
 #endif
@@ -105,7 +101,7 @@ class MenuToolbar: public FormGroup {
 #endif
 
   protected:
-    std::list<Window *>::iterator current = children.end();
+    int current = -1; // index of the current button in children
     T * choice;
     Menu * menu;
     coord_t y = 0;
@@ -141,7 +137,9 @@ class MenuToolbar: public FormGroup {
         menu->setFocusBody();
 
         // set current for page key procesing
-        current = std::find_if(children.begin(), children.end(), [button](Window *o) { return o == button; });
+        // -1 when the button is not a child anymore, current indexes children
+        auto it = std::find(children.begin(), children.end(), button);
+        current = it != children.end() ? it - children.begin() : -1;
         
         // clear all checked but the current button
         for (auto b : menuButtons) {
@@ -65,6 +65,44 @@ void NumberEdit::paint(BitmapBuffer * dc)
   }
 }
 
+#if defined(HARDWARE_KEYS)
+void NumberEdit::stepValue(int direction, uint16_t count)
+{
+  int value = getValue();
+  for (uint16_t i = 0; i < count && value >= vmin && value <= vmax; i++) {
+    do {
+      value += direction * ROTARY_ENCODER_SPEED() * step;
+    } while (isValueAvailable && !isValueAvailable(value) && value >= vmin && value <= vmax);
+  }
+
+  if (value > vmax) {
+    setValue(vmax);
+    onKeyError();
+  }
+  else if (value < vmin) {
+    setValue(vmin);
+    onKeyError();
+  }
+  else {
+    setValue(value);
+    onKeyPress();
+  }
+}
+
+void NumberEdit::onInputEvent(const InputEvent & input)
+{
+  if (editMode && input.event == EVT_ROTARY_RIGHT) {
+    stepValue(1, input.count);
+  }
+  else if (editMode && input.event == EVT_ROTARY_LEFT) {
+    stepValue(-1, input.count);
+  }
+  else {
+    BaseNumberEdit::onInputEvent(input);
+  }
+}
+#endif
+
 void NumberEdit::onEvent(event_t event)
 {
   TRACE_WINDOWS("%s received event 0x%X", getWindowDebugString().c_str(), event);
@@ -72,37 +110,13 @@ void NumberEdit::onEvent(event_t event)
   if (editMode) {
     switch (event) {
 #if defined(HARDWARE_KEYS)
-      case EVT_ROTARY_RIGHT: {
-        int value = getValue();
-        do {
-          value += ROTARY_ENCODER_SPEED() * step;
-        } while (isValueAvailable && !isValueAvailable(value) && value <= vmax);
-        if (value <= vmax) {
-          setValue(value);
-          onKeyPress();
-        }
-        else {
-          setValue(vmax);
-          onKeyError();
-        }
+      case EVT_ROTARY_RIGHT:
+        stepValue(1, 1);
         return;
-      }
-
-      case EVT_ROTARY_LEFT: {
-        int value = getValue();
-        do {
-          value -= ROTARY_ENCODER_SPEED() * step;
-        } while (isValueAvailable && !isValueAvailable(value) && value >= vmin);
-        if (value >= vmin) {
-          setValue(value);
-          onKeyPress();
-        }
-        else {
-          setValue(vmin);
-          onKeyError();
-        }
+
+      case EVT_ROTARY_LEFT:
+        stepValue(-1, 1);
         return;
-      }
 #endif
 
     case EVT_KEY_FIRST(KEY_EXIT):
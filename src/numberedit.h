@@ -64,6 +64,10 @@ class NumberEdit : public BaseNumberEdit
     void onEvent(event_t event) override;
     void onFocusLost() override;
 
+#if defined(HARDWARE_KEYS)
+    void onInputEvent(const InputEvent & input) override;
+#endif
+
 #if defined(HARDWARE_TOUCH)
     bool onTouchEnd(coord_t x, coord_t y) override;
 #endif
@@ -74,5 +78,9 @@ class NumberEdit : public BaseNumberEdit
     std::string suffix;
     std::string zeroText;
     std::function<bool(int)> isValueAvailable;
+
+#if defined(HARDWARE_KEYS)
+    void stepValue(int direction, uint16_t count);
+#endif
 };
 
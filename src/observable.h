@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <inttypes.h>
+#include "taskqueue.h"
+
+class Observer;
+
+// A source of changes, observers are notified synchronously (from the UI
+// thread) each time its version is incremented
+class ObservableBase
+{
+  friend class Observer;
+
+  public:
+    ObservableBase() = default;
+
+    ObservableBase(const ObservableBase &) = delete;
+
+    ObservableBase & operator=(const ObservableBase &) = delete;
+
+    ~ObservableBase();
+
+    uint32_t getVersion() const
+    {
+      return version;
+    }
+
+    // to be called when the source has changed without going through set()
+    void notify();
+
+  protected:
+    uint32_t version = 0;
+    Observer * observers = nullptr;
+};
+
+// Connection between an observable and a handler, disconnected when destroyed.
+// Usually a member of the window which has to be invalidated
+class Observer
+{
+  friend class ObservableBase;
+
+  public:
+    Observer() = default;
+
+    Observer(ObservableBase & source, std::function<void()> handler)
+    {
+      connect(source, std::move(handler));
+    }
+
+    Observer(const Observer &) = delete;
+
+    Observer & operator=(const Observer &) = delete;
+
+    ~Observer()
+    {
+      disconnect();
+    }
+
+    void connect(ObservableBase & newSource, std::function<void()> newHandler)
+    {
+      disconnect();
+      source = &newSource;
+      handler = std::move(newHandler);
+      next = source->observers;
+      if (next) {
+        next->previous = this;
+      }
+      source->observers = this;
+    }
+
+    void disconnect()
+    {
+      if (source) {
+        if (previous)
+          previous->next = next;
+        else
+          source->observers = next;
+        if (next)
+          next->previous = previous;
+        source = nullptr;
+        previous = next = nullptr;
+      }
+    }
+
+    bool isConnected() const
+    {
+      return source != nullptr;
+    }
+
+  protected:
+    ObservableBase * source = nullptr;
+    Observer * previous = nullptr;
+    Observer * next = nullptr;
+    std::function<void()> handler;
+};
+
+inline ObservableBase::~ObservableBase()
+{
+  while (observers) {
+    observers->disconnect();
+  }
+}
+
+inline void ObservableBase::notify()
+{
+  version++;
+  for (auto observer = observers; observer;) {
+    // the handler may disconnect its observer
+    auto next = observer->next;
+    observer->handler();
+    observer = next;
+  }
+}
+
+template <class T>
+class Observable: public ObservableBase
+{
+  public:
+    explicit Observable(T value = T()):
+      value(std::move(value))
+    {
+    }
+
+    const T & get() const
+    {
+      return value;
+    }
+
+    void set(T newValue)
+    {
+      if (newValue != value) {
+        value = std::move(newValue);
+        notify();
+      }
+    }
+
+    // from any thread, the value is set from the UI thread. The observable
+    // has to outlive the posted task
+    bool publish(T newValue)
+    {
+      return postToMainWindow([this, newValue]() {
+        set(newValue);
+      });
+    }
+
+  protected:
+    T value;
+};
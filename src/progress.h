@@ -26,6 +26,7 @@ class Progress: public Window {
     Progress(Window * parent, const rect_t & rect):
       Window(parent, rect)
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
     }
 
 #if defined(DEBUG_WINDOWS)
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#include <algorithm>
+#include "reconciler.h"
+#include "form.h"
+
+WindowReconciler::WindowReconciler(Window * parent):
+  parent(parent),
+  form(dynamic_cast<FormGroup *>(parent))
+{
+}
+
+int WindowReconciler::find(uint32_t key)
+{
+  // keys are most often declared in the same order as in the previous pass
+  for (size_t i = cursor; i < entries.size(); i++) {
+    if (entries[i].key == key && entries[i].window) {
+      cursor = i + 1;
+      return i;
+    }
+  }
+  for (size_t i = 0; i < cursor && i < entries.size(); i++) {
+    if (entries[i].key == key && entries[i].window) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void WindowReconciler::move(Window * window, const rect_t & rect)
+{
+  if (window->left() != rect.x || window->top() != rect.y || window->width() != rect.w || window->height() != rect.h) {
+    // the previous area has to be repainted too
+    window->invalidate();
+    window->setRect(rect);
+  }
+}
+
+void WindowReconciler::end()
+{
+  for (auto & entry: entries) {
+    if (entry.window) {
+      auto field = dynamic_cast<FormField *>(entry.window);
+      if (form && field) {
+        form->removeField(field);
+      }
+      entry.window->deleteLater();
+      changed = true;
+    }
+  }
+
+  std::swap(entries, declared);
+  declared.clear();
+
+  if (changed && form) {
+    linkFields();
+  }
+}
+
+void WindowReconciler::linkFields()
+{
+  std::vector<FormField *> declaredFields;
+  for (auto & entry: entries) {
+    auto field = dynamic_cast<FormField *>(entry.window);
+    if (field && !(field->getWindowFlags() & (NO_FOCUS | FORM_DETACHED))) {
+      declaredFields.push_back(field);
+    }
+  }
+
+  // the other fields of the form keep their order, the declared ones go back
+  // in their declaration order where the first of them was in the chain (the
+  // new ones were appended at the end by their constructor)
+  std::vector<FormField *> fields;
+  size_t position = 0;
+  bool found = false;
+  auto last = form->getLastField();
+  for (auto field = form->getFirstField(); field; field = field->getNextField()) {
+    if (std::find(declaredFields.begin(), declaredFields.end(), field) == declaredFields.end()) {
+      fields.push_back(field);
+    }
+    else if (!found) {
+      position = fields.size();
+      found = true;
+    }
+    if (field == last) {
+      break;
+    }
+  }
+  if (!found) {
+    position = fields.size();
+  }
+  fields.insert(fields.begin() + position, declaredFields.begin(), declaredFields.end());
+
+  form->setFirstField(nullptr);
+  form->setLastField(nullptr);
+  for (auto field: fields) {
+    field->setPreviousField(nullptr);
+    field->setNextField(nullptr);
+  }
+  for (auto field: fields) {
+    form->addField(field);
+  }
+}
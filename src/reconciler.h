@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "window.h"
+
+class FormGroup;
+
+// Rebuilds the children of a window from a declaration instead of
+// clear() + rebuild: each child is declared with a stable key between
+// begin() and end(), windows of already known keys are reused (moved when
+// their rect changed, then bound to the new data), new keys are created and
+// the keys which were not declared again are deleted.
+//
+//   reconciler.begin();
+//   for (auto & timer: timers) {
+//     // copied, the windows outlive this pass and timers may reallocate
+//     TimerData data = timer;
+//     reconciler.declare(timer.id, grid.getLineSlot(), [=](Window * parent, const rect_t & rect) {
+//       return new TimerLine(parent, rect, data);
+//     }, [=](Window * window) {
+//       static_cast<TimerLine *>(window)->setData(data);
+//     });
+//     grid.nextLine();
+//   }
+//   reconciler.end();
+//
+// The paint order of the reused windows is kept, the declaration order
+// only drives the rects and, in a FormGroup, the fields chain.
+class WindowReconciler
+{
+  public:
+    explicit WindowReconciler(Window * parent);
+
+    void begin()
+    {
+      declared.clear();
+      cursor = 0;
+      lastPosition = -1;
+      changed = false;
+    }
+
+    // create(parent, rect) is only called for a new key, update(window) only
+    // for a reused window, once it is moved
+    template <class F, class U>
+    Window * declare(uint32_t key, const rect_t & rect, F && create, U && update)
+    {
+      int position = find(key);
+      Window * window;
+      if (position < 0) {
+        window = create(parent, rect);
+        changed = true;
+      }
+      else {
+        window = entries[position].window;
+        entries[position].window = nullptr;
+        if (position < lastPosition) {
+          changed = true;
+        }
+        lastPosition = position;
+        move(window, rect);
+        update(window);
+      }
+      declared.push_back({key, window});
+      return window;
+    }
+
+    // for the windows which don't depend on anything else than their key
+    template <class F>
+    Window * declare(uint32_t key, const rect_t & rect, F && create)
+    {
+      return declare(key, rect, std::forward<F>(create), [](Window *) {});
+    }
+
+    // deletes the windows which were not declared, relinks the form fields if needed
+    void end();
+
+    // the window of a key declared in the last pass, nullptr if none
+    Window * getWindow(uint32_t key) const
+    {
+      for (auto & entry: entries) {
+        if (entry.key == key) {
+          return entry.window;
+        }
+      }
+      return nullptr;
+    }
+
+  protected:
+    struct Entry {
+      uint32_t key;
+      Window * window;
+    };
+
+    Window * parent;
+    FormGroup * form;
+    std::vector<Entry> entries;
+    std::vector<Entry> declared;
+    size_t cursor = 0;
+    int lastPosition = -1;
+    bool changed = false;
+
+    int find(uint32_t key);
+    static void move(Window * window, const rect_t & rect);
+    void linkFields();
+};
@@ -88,7 +88,10 @@ class Roller: public Choice
 
         unsigned valueIndex = displayedValue - vmin;
         if (valueIndex < values.size()) {
-          dc->drawText(width() / 2, y, values[valueIndex].c_str(), fgColor | CENTERED);
+          size_t length;
+          auto text = values.getText(valueIndex, length);
+          // drawSizedText() draws at most 255 chars, far more than the roller width
+          dc->drawSizedText(width() / 2, y, text, min<size_t>(255, length), fgColor | CENTERED);
         }
         else {
           dc->drawNumber(width() / 2, y, displayedValue, fgColor | CENTERED);
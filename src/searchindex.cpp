@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <algorithm>
+#include "searchindex.h"
+
+std::string SearchIndex::toLower(const std::string & text)
+{
+  std::string result(text);
+  for (auto & c: result) {
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+  }
+  return result;
+}
+
+void SearchIndex::clear()
+{
+  keys.clear();
+  trigrams.clear();
+  postingsStart.clear();
+  postings.clear();
+}
+
+void SearchIndex::build(const std::vector<std::string> & texts)
+{
+  clear();
+
+  // (trigram, entry) pairs, sorted then grouped by trigram
+  std::vector<uint64_t> pairs;
+  keys.reserve(texts.size());
+  for (uint32_t entry = 0; entry < texts.size(); entry++) {
+    keys.push_back(toLower(texts[entry]));
+    const auto & key = keys.back();
+    for (size_t i = 0; i + SEARCH_INDEX_MIN_QUERY <= key.size(); i++) {
+      pairs.push_back((uint64_t(getTrigram(&key[i])) << 32u) + entry);
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+  postings.reserve(pairs.size());
+  for (auto pair: pairs) {
+    auto trigram = uint32_t(pair >> 32u);
+    if (trigrams.empty() || trigrams.back() != trigram) {
+      trigrams.push_back(trigram);
+      postingsStart.push_back(postings.size());
+    }
+    postings.push_back(uint32_t(pair));
+  }
+  postingsStart.push_back(postings.size());
+}
+
+void SearchIndex::search(const std::string & query, std::vector<uint32_t> & result, bool narrow) const
+{
+  auto key = toLower(query);
+
+  if (narrow) {
+    result.erase(std::remove_if(result.begin(), result.end(), [&](uint32_t entry) {
+      return keys[entry].find(key) == std::string::npos;
+    }), result.end());
+    return;
+  }
+
+  result.clear();
+
+  if (key.size() < SEARCH_INDEX_MIN_QUERY) {
+    for (uint32_t entry = 0; entry < keys.size(); entry++) {
+      if (keys[entry].find(key) != std::string::npos) {
+        result.push_back(entry);
+      }
+    }
+    return;
+  }
+
+  // the entries of the rarest trigram of the query are the candidates
+  uint32_t first = 0, last = UINT32_MAX;
+  for (size_t i = 0; i + SEARCH_INDEX_MIN_QUERY <= key.size(); i++) {
+    auto it = std::lower_bound(trigrams.begin(), trigrams.end(), getTrigram(&key[i]));
+    if (it == trigrams.end() || *it != getTrigram(&key[i]))
+      return;
+    auto index = it - trigrams.begin();
+    if (postingsStart[index + 1] - postingsStart[index] < last - first) {
+      first = postingsStart[index];
+      last = postingsStart[index + 1];
+    }
+  }
+
+  for (uint32_t i = first; i < last; i++) {
+    auto entry = postings[i];
+    if (key.size() == SEARCH_INDEX_MIN_QUERY || keys[entry].find(key) != std::string::npos) {
+      result.push_back(entry);
+    }
+  }
+}
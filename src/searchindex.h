@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+// shorter queries are searched by scanning the entries
+constexpr uint8_t SEARCH_INDEX_MIN_QUERY = 3;
+
+// Case insensitive substring search in a list of texts. The index gives the
+// entries containing each trigram, a query is then only compared with the
+// entries containing its rarest trigram
+class SearchIndex
+{
+  public:
+    SearchIndex() = default;
+
+    explicit SearchIndex(const std::vector<std::string> & texts)
+    {
+      build(texts);
+    }
+
+    void build(const std::vector<std::string> & texts);
+
+    void clear();
+
+    uint32_t size() const
+    {
+      return keys.size();
+    }
+
+    // result receives the entries containing query, in ascending order. With
+    // narrow, result holds the entries found for a query contained in this
+    // one (the previous keystroke) and only these are checked
+    void search(const std::string & query, std::vector<uint32_t> & result, bool narrow = false) const;
+
+  protected:
+    std::vector<std::string> keys;
+    std::vector<uint32_t> trigrams;
+    std::vector<uint32_t> postingsStart;
+    std::vector<uint32_t> postings;
+
+    static std::string toLower(const std::string & text);
+
+    static uint32_t getTrigram(const char * text)
+    {
+      return (uint8_t(text[0]) << 16u) + (uint8_t(text[1]) << 8u) + uint8_t(text[2]);
+    }
+};
@@ -51,6 +51,18 @@ void Slider::onEvent(event_t event)
 
   FormField::onEvent(event);
 }
+
+void Slider::onInputEvent(const InputEvent & input)
+{
+  if (editMode && (input.event == EVT_ROTARY_RIGHT || input.event == EVT_ROTARY_LEFT)) {
+    int delta = input.count * ROTARY_ENCODER_SPEED();
+    setValue(getValue() + (input.event == EVT_ROTARY_RIGHT ? delta : -delta));
+    onKeyPress();
+  }
+  else {
+    FormField::onInputEvent(input);
+  }
+}
 #endif
 
 #if defined(HARDWARE_TOUCH)
@@ -49,6 +49,8 @@ class Slider: public FormField {
 
 #if defined(HARDWARE_KEYS)
     void onEvent(event_t event) override;
+
+    void onInputEvent(const InputEvent & input) override;
 #endif
 
 #if defined(HARDWARE_TOUCH)
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "window.h"
+#include "observable.h"
 #include "button.h" // TODO just for BUTTON_BACKGROUND
 
 class StaticText: public Window
@@ -29,6 +30,7 @@ class StaticText: public Window
       Window(parent, rect, windowFlags, textFlags),
       text(std::move(text))
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
       if (windowFlags & BUTTON_BACKGROUND) {
         setBackgroundColor(COLOR_THEME_SECONDARY2);
       }
@@ -83,6 +85,7 @@ class StaticBitmap: public Window
       Window(parent, rect),
       scale(scale)
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
     }
 
     StaticBitmap(Window * parent, const rect_t & rect, const char * filename, bool scale = false):
@@ -90,6 +93,7 @@ class StaticBitmap: public Window
       bitmap(BitmapBuffer::loadBitmap(filename)),
       scale(scale)
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
     }
 
     StaticBitmap(Window * parent, const rect_t & rect, const BitmapBuffer * bitmap, bool scale = false):
@@ -97,6 +101,7 @@ class StaticBitmap: public Window
       bitmap(bitmap),
       scale(scale)
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
     }
 
     StaticBitmap(Window * parent, const rect_t & rect, const BitmapBuffer * mask, LcdFlags color, bool scale = false):
@@ -105,6 +110,7 @@ class StaticBitmap: public Window
       color(color),
       scale(scale)
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
     }
 
     void setBitmap(const char * filename)
@@ -154,22 +160,50 @@ class DynamicText: public StaticText
   public:
     DynamicText(Window * parent, const rect_t & rect, std::function<std::string()> textHandler, LcdFlags textFlags = 0):
       StaticText(parent, rect, "", 0, textFlags),
-      textHandler(std::move(textHandler))
+      textHandler(std::move(textHandler)),
+      polling(true)
     {
+      setEventInterest(EVENT_INTEREST_DYNAMIC);
+    }
+
+    // the text is only computed again (at paint time) when the source has changed
+    DynamicText(Window * parent, const rect_t & rect, ObservableBase & source, std::function<std::string()> textHandler, LcdFlags textFlags = 0):
+      StaticText(parent, rect, "", 0, textFlags),
+      textHandler(std::move(textHandler)),
+      observer(source, [this]() {
+        textChanged = true;
+        invalidate();
+      })
+    {
+      text = this->textHandler();
     }
 
     void checkEvents() override
     {
       StaticText::checkEvents();
-      std::string newText = textHandler();
-      if (newText != text) {
-        text = newText;
-        invalidate();
+      if (polling) {
+        std::string newText = textHandler();
+        if (newText != text) {
+          text = newText;
+          invalidate();
+        }
       }
     }
 
+    void paint(BitmapBuffer * dc) override
+    {
+      if (textChanged) {
+        textChanged = false;
+        text = textHandler();
+      }
+      StaticText::paint(dc);
+    }
+
   protected:
     std::function<std::string()> textHandler;
+    bool polling = false;
+    bool textChanged = false;
+    Observer observer;
 };
 
 template <class T>
@@ -184,6 +218,21 @@ class DynamicNumber: public Window
     {
     }
 
+    DynamicNumber(Window * parent, const rect_t & rect, Observable<T> & source, LcdFlags textFlags = 0, const char * prefix = nullptr, const char * suffix = nullptr):
+      Window(parent, rect, 0, textFlags),
+      value(source.get()),
+      prefix(prefix),
+      suffix(suffix),
+      observer(source, [this, &source]() {
+        if (value != source.get()) {
+          value = source.get();
+          invalidate();
+        }
+      })
+    {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, false);
+    }
+
     void paint(BitmapBuffer * dc) override
     {
       dc->drawNumber(0, FIELD_PADDING_TOP, value, textFlags, 0, prefix, suffix);
@@ -191,10 +240,12 @@ class DynamicNumber: public Window
 
     void checkEvents() override
     {
-      T newValue = numberHandler();
-      if (value != newValue) {
-        value = newValue;
-        invalidate();
+      if (numberHandler) {
+        T newValue = numberHandler();
+        if (value != newValue) {
+          value = newValue;
+          invalidate();
+        }
       }
     }
 
@@ -203,4 +254,5 @@ class DynamicNumber: public Window
     std::function<T()> numberHandler;
     const char * prefix;
     const char * suffix;
+    Observer observer;
 };
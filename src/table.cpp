@@ -35,6 +35,94 @@ void Table::Header::paint(BitmapBuffer * dc)
   }
 }
 
+Table::DataSource::~DataSource()
+{
+  if (body) {
+    body->dataSource = nullptr;
+    body->updateRowCount();
+  }
+}
+
+void Table::DataSource::notifyRowsChanged(unsigned first, unsigned count)
+{
+  if (body) {
+    body->invalidateRows(first, count);
+  }
+}
+
+void Table::DataSource::notifyRowCountChanged()
+{
+  if (body) {
+    body->updateRowCount();
+  }
+}
+
+void Table::Body::setDataSource(DataSource * source)
+{
+  if (dataSource) {
+    dataSource->body = nullptr;
+  }
+  clear();
+  dataSource = source;
+  if (dataSource) {
+    if (dataSource->body) {
+      dataSource->body->setDataSource(nullptr);
+    }
+    dataSource->body = this;
+  }
+  selection = -1;
+  updateRowCount();
+}
+
+void Table::Body::updateRowCount()
+{
+  int count = getRowCount();
+  setInnerHeight(count > 0 ? count * TABLE_LINE_HEIGHT - 2 : 0);
+  if (selection >= count) {
+    selection = count - 1;
+  }
+  invalidate();
+}
+
+void Table::Body::getVisibleRows(unsigned & first, unsigned & last) const
+{
+  coord_t top = getScrollPositionY();
+  coord_t bottom = top + height();
+
+  // the parents scroll the body when it has FORWARD_SCROLL, shift is the
+  // offset from the body content to the parent content
+  coord_t shift = 0;
+  for (const Window * window = this; window->getParent() && top < bottom; window = window->getParent()) {
+    auto parent = window->getParent();
+    shift += window->top() - window->getScrollPositionY();
+    top = max(top, parent->getScrollPositionY() - shift);
+    bottom = min(bottom, parent->getScrollPositionY() + parent->height() - shift);
+  }
+
+  unsigned count = getRowCount();
+  if (top >= bottom) {
+    first = last = 0;
+    return;
+  }
+  first = min<unsigned>(count, max<coord_t>(0, top) / TABLE_LINE_HEIGHT);
+  last = min<unsigned>(count, (max<coord_t>(0, bottom) + TABLE_LINE_HEIGHT - 1) / TABLE_LINE_HEIGHT);
+}
+
+void Table::Body::invalidateRows(unsigned first, unsigned count)
+{
+  unsigned visibleFirst, visibleLast;
+  getVisibleRows(visibleFirst, visibleLast);
+  if (first >= visibleLast)
+    return;
+  unsigned last = first + min(count, visibleLast - first);
+  first = max(first, visibleFirst);
+  if (first < last) {
+    // invalidate() takes viewport coordinates
+    coord_t y = first * TABLE_LINE_HEIGHT - getScrollPositionY();
+    invalidate({0, y, width(), coord_t((last - first) * TABLE_LINE_HEIGHT)});
+  }
+}
+
 void Table::Body::checkEvents()
 {
   Window::checkEvents();
@@ -42,39 +130,64 @@ void Table::Body::checkEvents()
   if (_deleted)
     return;
 
-  coord_t y = 0;
-  for (auto line: lines) {
+  if (dataSource) {
+    dataSource->checkEvents();
+    return;
+  }
+
+  // the rows out of view are repainted when scrolled in
+  unsigned first, last;
+  getVisibleRows(first, last);
+
+  auto now = ticksNow();
+  for (unsigned index = first; index < last; index++) {
+    auto line = lines[index];
+    coord_t y = index * TABLE_LINE_HEIGHT - getScrollPositionY();
     coord_t x = 10;
     for (unsigned i = 0; i < line->cells.size(); i++) {
       auto cell = line->cells[i];
       auto width = static_cast<Table *>(parent)->columnsWidth[i];
-      if (cell && cell->needsInvalidate()) {
+      if (cell && cell->checkInvalidate(now)) {
         invalidate({x, y, width, TABLE_LINE_HEIGHT - 2});
       }
       x += width;
     }
-    y += TABLE_LINE_HEIGHT;
   }
 }
 
 void Table::Body::paint(BitmapBuffer * dc)
 {
-  coord_t y = 0;
-  int index = 0;
   dc->clear(COLOR_THEME_SECONDARY3);
-  for (auto line: lines) {
+
+  // only the rows inside the clipping rect
+  coord_t xmin, xmax, ymin, ymax;
+  dc->getClippingRect(xmin, xmax, ymin, ymax);
+  ymin -= dc->getOffsetY();
+  ymax -= dc->getOffsetY();
+  int count = getRowCount();
+  int first = max<coord_t>(0, ymin) / TABLE_LINE_HEIGHT;
+  int last = min<int>(count, (max<coord_t>(0, ymax) + TABLE_LINE_HEIGHT - 1) / TABLE_LINE_HEIGHT);
+
+  auto & columnsWidth = static_cast<Table *>(parent)->columnsWidth;
+  for (int index = first; index < last; index++) {
+    coord_t y = index * TABLE_LINE_HEIGHT;
     bool highlight = (index == selection);
     dc->drawSolidFilledRect(0, y, width(), TABLE_LINE_HEIGHT - 2, highlight ? COLOR_THEME_FOCUS : COLOR_THEME_SECONDARY3);
+    LcdFlags lineFlags = dataSource ? dataSource->getRowFlags(index) : lines[index]->flags;
+    LcdFlags flags = lineFlags + (highlight ? COLOR_THEME_PRIMARY2 - COLOR_MASK(lineFlags) : COLOR_THEME_SECONDARY1);
     coord_t x = 10;
-    for (unsigned i = 0; i < line->cells.size(); i++) {
-      auto cell = line->cells[i];
-      if (cell) {
-        cell->paint(dc, x, y, line->flags + (highlight ? COLOR_THEME_PRIMARY2 - COLOR_MASK(line->flags) : COLOR_THEME_SECONDARY1));
+    for (uint8_t i = 0; i < columnsWidth.size(); i++) {
+      if (dataSource) {
+        dataSource->paintCell(dc, index, i, x, y, flags);
       }
-      x += static_cast<Table *>(parent)->columnsWidth[i];
+      else if (i < lines[index]->cells.size()) {
+        auto cell = lines[index]->cells[i];
+        if (cell) {
+          cell->paint(dc, x, y, flags);
+        }
+      }
+      x += columnsWidth[i];
     }
-    y += TABLE_LINE_HEIGHT;
-    index += 1;
   }
 }
 
@@ -82,18 +195,36 @@ void Table::Body::paint(BitmapBuffer * dc)
 bool Table::Body::onTouchEnd(coord_t x, coord_t y)
 {
   unsigned index = y / TABLE_LINE_HEIGHT;
-  if (index < lines.size()) {
+  if (index < getRowCount()) {
     onKeyPress();
     setFocus(SET_FOCUS_DEFAULT);
-    auto onPress = lines[index]->onPress;
-    if (onPress)
-      onPress();
+    press(index);
   }
   return true;
 }
 #endif
 
 #if defined(HARDWARE_KEYS)
+void Table::Body::onInputEvent(const InputEvent & input)
+{
+  auto table = static_cast<Table *>(parent);
+  if ((input.event == EVT_ROTARY_RIGHT || input.event == EVT_ROTARY_LEFT) && !(table->getWindowFlags() & FORWARD_SCROLL)) {
+    // the selection wraps, the steps are applied at once
+    onKeyPress();
+    int count = getRowCount();
+    if (count > 0) {
+      int steps = input.count % count;
+      if (input.event == EVT_ROTARY_RIGHT)
+        select((selection + steps + count) % count, true);
+      else
+        select(selection < 0 ? (count - steps) % count : (selection - steps + count) % count, true);
+    }
+  }
+  else {
+    Window::onInputEvent(input);
+  }
+}
+
 void Table::Body::onEvent(event_t event)
 {
   TRACE_WINDOWS("%s received event 0x%X", getWindowDebugString().c_str(), event);
@@ -101,9 +232,7 @@ void Table::Body::onEvent(event_t event)
   if (event == EVT_KEY_BREAK(KEY_ENTER)) {
     if (selection >= 0) {
       onKeyPress();
-      auto onPress = lines[selection]->onPress;
-      if (onPress)
-        onPress();
+      press(selection);
     }
   }
   if (event == EVT_ROTARY_RIGHT) {
@@ -111,7 +240,7 @@ void Table::Body::onEvent(event_t event)
     auto table = static_cast<Table *>(parent);
     if (table->getWindowFlags() & FORWARD_SCROLL) {
       auto index = selection + 1;
-      if (index < int(lines.size())) {
+      if (index < int(getRowCount())) {
         select(index, true);
       }
       else {
@@ -125,8 +254,8 @@ void Table::Body::onEvent(event_t event)
       }
     }
     else {
-      if (!lines.empty()) {
-        select((selection + 1) % lines.size(), true);
+      if (getRowCount() > 0) {
+        select((selection + 1) % getRowCount(), true);
       }
     }
   }
@@ -147,8 +276,8 @@ void Table::Body::onEvent(event_t event)
       }
     }
     else {
-      if (!lines.empty()) {
-        select(selection <= 0 ? lines.size() - 1 : selection - 1, true);
+      if (getRowCount() > 0) {
+        select(selection <= 0 ? getRowCount() - 1 : selection - 1, true);
       }
     }
   }
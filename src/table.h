@@ -28,6 +28,67 @@
 class Table: public FormField
 {
   public:
+    class Body;
+
+    // Rows provided on demand, in place of Line objects, for long tables.
+    // Only the visible rows are painted, the source tells the table which
+    // rows have changed. It has to outlive the table or be destroyed first
+    class DataSource
+    {
+      friend class Body;
+
+      public:
+        virtual ~DataSource();
+
+        virtual unsigned getRowCount() const = 0;
+
+        virtual void paintCell(BitmapBuffer * dc, unsigned row, uint8_t column, coord_t x, coord_t y, LcdFlags flags) = 0;
+
+        virtual LcdFlags getRowFlags(unsigned row) const
+        {
+          return TABLE_BODY_FONT;
+        }
+
+        virtual void onPress(unsigned row)
+        {
+        }
+
+        virtual void onSelect(unsigned row)
+        {
+        }
+
+        // what TableIndexView::sortByColumn() sorts on, copied on the UI
+        // thread so that the sort can run on another one
+        struct SortKey {
+          int32_t number = 0;
+          std::string text;
+
+          bool operator<(const SortKey & other) const
+          {
+            return number != other.number ? number < other.number : text < other.text;
+          }
+        };
+
+        virtual void getSortKey(unsigned row, uint8_t column, SortKey & key) const
+        {
+          key.number = row;
+        }
+
+        // called on each checkEvents() of the table showing the source
+        virtual void checkEvents()
+        {
+        }
+
+        // the content of count rows from first has changed
+        void notifyRowsChanged(unsigned first, unsigned count = 1);
+
+        // rows have been added or removed
+        void notifyRowCountChanged();
+
+      protected:
+        Body * body = nullptr;
+    };
+
     class Cell
     {
       public:
@@ -36,6 +97,26 @@ class Table: public FormField
         virtual void paint(BitmapBuffer * dc, coord_t x, coord_t y, LcdFlags flags) = 0;
 
         virtual bool needsInvalidate() = 0;
+
+        // the cell is checked at most once per period, 0 for each tick
+        void setRefreshPeriod(uint32_t ms)
+        {
+          refreshPeriod = ms * SYSTEM_TICKS_1MS;
+        }
+
+        bool checkInvalidate(uint32_t now)
+        {
+          if (refreshPeriod) {
+            if (now - lastCheck < refreshPeriod)
+              return false;
+            lastCheck = now;
+          }
+          return needsInvalidate();
+        }
+
+      protected:
+        uint32_t refreshPeriod = 0;
+        uint32_t lastCheck = 0;
     };
 
     class StringCell : public Cell
@@ -72,17 +153,28 @@ class Table: public FormField
 
         void paint(BitmapBuffer * dc, coord_t x, coord_t y, LcdFlags flags) override
         {
-          auto text = getText();
+          if (!valid) {
+            text = getText();
+            valid = true;
+          }
           dc->drawText(x, y - 2 + (TABLE_LINE_HEIGHT - getFontHeight(TABLE_BODY_FONT)) / 2 + 3, text.c_str(), SPACING_NUMBERS_CONST | flags);
         }
 
+        // the text painted is the one read here
         bool needsInvalidate() override
         {
-          return true; // TODO optimize this
+          auto value = getText();
+          if (valid && value == text)
+            return false;
+          text = std::move(value);
+          valid = true;
+          return true;
         }
 
       protected:
         std::function<std::string()> getText;
+        std::string text;
+        bool valid = false;
     };
 
     class CustomCell : public Cell
@@ -93,6 +185,14 @@ class Table: public FormField
         {
         }
 
+        // getHash returns a value which changes with what is painted, the cell
+        // is then repainted only on changes
+        CustomCell(std::function<void(BitmapBuffer * /*dc*/, coord_t /*x*/, coord_t /*y*/, LcdFlags /*flags*/)> paintFunction, std::function<uint32_t()> getHash):
+          paintFunction(std::move(paintFunction)),
+          getHash(std::move(getHash))
+        {
+        }
+
         void paint(BitmapBuffer * dc, coord_t x, coord_t y, LcdFlags flags) override
         {
           paintFunction(dc, x, y, flags);
@@ -100,11 +200,21 @@ class Table: public FormField
 
         bool needsInvalidate() override
         {
+          if (!getHash)
+            return true;
+          auto value = getHash();
+          if (valid && value == hash)
+            return false;
+          hash = value;
+          valid = true;
           return true;
         }
 
       protected:
         std::function<void(BitmapBuffer * dc, coord_t x, coord_t y, LcdFlags flags)> paintFunction;
+        std::function<uint32_t()> getHash;
+        uint32_t hash = 0;
+        bool valid = false;
     };
 
     class Line
@@ -159,6 +269,9 @@ class Table: public FormField
         ~Body() override
         {
           clear();
+          if (dataSource) {
+            dataSource->body = nullptr;
+          }
         }
 
 #if defined(DEBUG_WINDOWS)
@@ -193,6 +306,20 @@ class Table: public FormField
           lines.clear();
         }
 
+        void setDataSource(DataSource * source);
+
+        unsigned getRowCount() const
+        {
+          return dataSource ? dataSource->getRowCount() : lines.size();
+        }
+
+        // the rows range in the visible part of the body, last excluded
+        void getVisibleRows(unsigned & first, unsigned & last) const;
+
+        void invalidateRows(unsigned first, unsigned count);
+
+        void updateRowCount();
+
         void select(int index, bool scroll)
         {
           selection = index;
@@ -213,17 +340,36 @@ class Table: public FormField
           }
           invalidate();
           if (index >= 0) {
-            auto onSelect = lines[index]->onSelect;
-            if (onSelect) {
-              onSelect();
+            if (dataSource) {
+              dataSource->onSelect(index);
+            }
+            else {
+              auto onSelect = lines[index]->onSelect;
+              if (onSelect) {
+                onSelect();
+              }
             }
           }
         }
 
+        void press(int index)
+        {
+          if (dataSource) {
+            dataSource->onPress(index);
+          }
+          else {
+            auto onPress = lines[index]->onPress;
+            if (onPress)
+              onPress();
+          }
+        }
+
         void paint(BitmapBuffer * dc) override;
 
 #if defined(HARDWARE_KEYS)
         void onEvent(event_t event) override;
+
+        void onInputEvent(const InputEvent & input) override;
 #endif
 
 #if defined(HARDWARE_TOUCH)
@@ -234,6 +380,7 @@ class Table: public FormField
 
       protected:
         std::vector<Line *> lines;
+        DataSource * dataSource = nullptr;
         int selection = -1;
     };
 
@@ -297,7 +444,7 @@ class Table: public FormField
 
     void setFocus(uint8_t flag = SET_FOCUS_DEFAULT, Window * from = nullptr) override // NOLINT(google-default-arguments)
     {
-      if (body.lines.empty()) {
+      if (body.getRowCount() == 0) {
         if (flag == SET_FOCUS_BACKWARD) {
           if (previous) {
             previous->setFocus(flag, this);
@@ -312,7 +459,7 @@ class Table: public FormField
       else {
         body.setFocus(flag, from);
         if (body.selection < 0) {
-          select(flag == SET_FOCUS_BACKWARD ? (int)body.lines.size() - 1 : 0);
+          select(flag == SET_FOCUS_BACKWARD ? (int)body.getRowCount() - 1 : 0);
         }
       }
     }
@@ -359,11 +506,27 @@ class Table: public FormField
       body.clear();
     }
 
+    // replaces the lines, nullptr goes back to an empty table of lines
+    void setDataSource(DataSource * source)
+    {
+      body.setDataSource(source);
+    }
+
+    void notifyRowsChanged(unsigned first, unsigned count = 1)
+    {
+      body.invalidateRows(first, count);
+    }
+
     uint8_t size() const
     {
       return body.lines.size();
     }
 
+    unsigned getRowCount() const
+    {
+      return body.getRowCount();
+    }
+
   protected:
     uint8_t columnsCount;
     std::vector<coord_t> columnsWidth;
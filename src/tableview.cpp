@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#include <algorithm>
+#include "tableview.h"
+#include "mainwindow.h"
+
+TableIndexView::TableIndexView(Table::DataSource * source):
+  source(source),
+  state(std::make_shared<State>())
+{
+  state->view = this;
+  update();
+}
+
+TableIndexView::~TableIndexView()
+{
+  // the results of the running tasks are dropped
+  state->view = nullptr;
+  state->generation++;
+}
+
+void TableIndexView::setCompare(Compare value)
+{
+  compare = std::move(value);
+  sortColumn = -1;
+  update();
+}
+
+void TableIndexView::sortByColumn(uint8_t column, bool ascending)
+{
+  compare = nullptr;
+  sortColumn = column;
+  sortAscending = ascending;
+  update();
+}
+
+void TableIndexView::setFilter(Filter value)
+{
+  filter = std::move(value);
+  update();
+}
+
+void TableIndexView::filterRows(std::vector<unsigned> & result) const
+{
+  auto count = source->getRowCount();
+  result.clear();
+  result.reserve(count);
+  for (unsigned row = 0; row < count; row++) {
+    if (!filter || filter(row)) {
+      result.push_back(row);
+    }
+  }
+}
+
+bool TableIndexView::keyLessThan(unsigned row1, unsigned row2) const
+{
+  SortKey key1, key2;
+  source->getSortKey(row1, sortColumn, key1);
+  source->getSortKey(row2, sortColumn, key2);
+  return sortAscending ? key1 < key2 : key2 < key1;
+}
+
+bool TableIndexView::sort(SortTask & task, const std::atomic<uint32_t> & generation)
+{
+  // bottom-up merge sort of the keys positions, stable, and cancelled between two merges
+  auto & keys = task.keys;
+  auto less = [&](unsigned a, unsigned b) {
+    return task.ascending ? keys[a] < keys[b] : keys[b] < keys[a];
+  };
+
+  size_t count = keys.size();
+  std::vector<unsigned> order(count), buffer(count);
+  for (size_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+
+  size_t merged = 0;
+  for (size_t width = 1; width < count; width *= 2) {
+    for (size_t left = 0; left < count; left += 2 * width) {
+      auto middle = std::min(left + width, count);
+      auto right = std::min(left + 2 * width, count);
+      std::merge(order.begin() + left, order.begin() + middle, order.begin() + middle, order.begin() + right, buffer.begin() + left, less);
+      merged += right - left;
+      // a newer update cancels this one
+      if (merged >= 256) {
+        merged = 0;
+        if (generation.load(std::memory_order_relaxed) != task.generation)
+          return false;
+      }
+    }
+    order.swap(buffer);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    buffer[i] = task.rows[order[i]];
+  }
+  task.rows.swap(buffer);
+  return true;
+}
+
+void TableIndexView::applySort()
+{
+  if (sortTask && sortTask->done.load(std::memory_order_acquire)) {
+    auto task = sortTask;
+    sortTask = nullptr;
+    // same rows as the ones shown since update(), only their order changes
+    rows.swap(task->rows);
+    updating = false;
+    if (!rows.empty()) {
+      notifyRowsChanged(0, rows.size());
+    }
+  }
+}
+
+void TableIndexView::setRows(std::vector<unsigned> & result)
+{
+  rows.swap(result);
+  updating = false;
+  notifyRowCountChanged();
+}
+
+void TableIndexView::update()
+{
+  auto generation = ++state->generation;
+  sortTask = nullptr;
+
+  std::vector<unsigned> result;
+  filterRows(result);
+
+  if (compare) {
+    std::stable_sort(result.begin(), result.end(), compare);
+  }
+  else if (sortColumn >= 0) {
+    auto task = std::make_shared<SortTask>();
+    task->generation = generation;
+    task->ascending = sortAscending;
+    task->done = false;
+    task->rows.swap(result);
+    task->keys.resize(task->rows.size());
+    for (size_t i = 0; i < task->rows.size(); i++) {
+      source->getSortKey(task->rows[i], sortColumn, task->keys[i]);
+    }
+
+    if (executor) {
+      // the filtered rows are published now, in the source order, so that
+      // the table never reads indexes which the source doesn't have anymore
+      result = task->rows;
+      sortTask = task;
+      auto sharedState = state;
+      executor([=]() {
+        if (!sort(*task, sharedState->generation))
+          return;
+        task->done.store(true, std::memory_order_release);
+        // posted once, when the queue is full the table takes the result on its next checkEvents()
+        MainWindow::post([=]() {
+          auto view = sharedState->view;
+          if (view && view->sortTask == task) {
+            view->applySort();
+          }
+        });
+      });
+      setRows(result);
+      updating = true;
+      return;
+    }
+
+    sort(*task, state->generation);
+    result.swap(task->rows);
+  }
+
+  setRows(result);
+}
+
+void TableIndexView::insertSourceRow(unsigned row)
+{
+  if (updating) {
+    // the view in progress doesn't have this row yet
+    update();
+    return;
+  }
+
+  for (auto & index: rows) {
+    if (index >= row) {
+      index++;
+    }
+  }
+
+  if (filter && !filter(row))
+    return;
+
+  if (compare) {
+    rows.insert(std::upper_bound(rows.begin(), rows.end(), row, compare), row);
+  }
+  else if (sortColumn >= 0) {
+    rows.insert(std::upper_bound(rows.begin(), rows.end(), row, [=](unsigned row1, unsigned row2) {
+      return keyLessThan(row1, row2);
+    }), row);
+  }
+  else {
+    rows.insert(std::upper_bound(rows.begin(), rows.end(), row), row);
+  }
+  notifyRowCountChanged();
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "table.h"
+
+// A sorted and filtered view of the rows of another data source, given to
+// the table in place of it. The view only holds the indexes of the source
+// rows. The filter and the custom compare functions read the source, so they
+// run on the UI thread. With an executor, sortByColumn() copies the sort keys
+// of the rows on the UI thread and sorts the copy on a worker thread, which
+// never reads the source. Meanwhile the view shows the filtered rows in the
+// source order. A newer update cancels the sort in progress
+class TableIndexView: public Table::DataSource
+{
+  public:
+    typedef std::function<bool(unsigned /*row1*/, unsigned /*row2*/)> Compare;
+    typedef std::function<bool(unsigned /*row*/)> Filter;
+    typedef std::function<void(std::function<void()> /*task*/)> Executor;
+
+    explicit TableIndexView(Table::DataSource * source);
+
+    ~TableIndexView() override;
+
+    // runs the sorts on a worker thread, without executor they are done synchronously
+    void setExecutor(Executor value)
+    {
+      executor = std::move(value);
+    }
+
+    // the rows are sorted on the UI thread, as compare reads the source
+    void setCompare(Compare value);
+
+    void sortByColumn(uint8_t column, bool ascending = true);
+
+    void setFilter(Filter value);
+
+    // to be called when the content of the source has changed
+    void update();
+
+    // to be called when a row was inserted in the source at this index
+    void insertSourceRow(unsigned row);
+
+    unsigned getSourceRow(unsigned row) const
+    {
+      return rows[row];
+    }
+
+    bool isUpdating() const
+    {
+      return updating;
+    }
+
+    unsigned getRowCount() const override
+    {
+      return rows.size();
+    }
+
+    void paintCell(BitmapBuffer * dc, unsigned row, uint8_t column, coord_t x, coord_t y, LcdFlags flags) override
+    {
+      source->paintCell(dc, rows[row], column, x, y, flags);
+    }
+
+    LcdFlags getRowFlags(unsigned row) const override
+    {
+      return source->getRowFlags(rows[row]);
+    }
+
+    void onPress(unsigned row) override
+    {
+      source->onPress(rows[row]);
+    }
+
+    void onSelect(unsigned row) override
+    {
+      source->onSelect(rows[row]);
+    }
+
+    // takes a sort whose result couldn't be posted, the tasks queue being full
+    void checkEvents() override
+    {
+      applySort();
+    }
+
+  protected:
+    // shared with the tasks still running once the view is destroyed
+    struct State {
+      std::atomic<uint32_t> generation { 0 };
+      TableIndexView * view;
+    };
+
+    // a sort on the worker thread, with its own copy of the keys
+    struct SortTask {
+      uint32_t generation;
+      bool ascending;
+      std::vector<unsigned> rows;
+      std::vector<SortKey> keys;
+      std::atomic<bool> done;
+    };
+
+    Table::DataSource * source;
+    std::shared_ptr<State> state;
+    std::vector<unsigned> rows;
+    Compare compare;
+    Filter filter;
+    Executor executor;
+    int sortColumn = -1;
+    bool sortAscending = true;
+    std::shared_ptr<SortTask> sortTask;
+    bool updating = false;
+
+    void filterRows(std::vector<unsigned> & result) const;
+
+    bool keyLessThan(unsigned row1, unsigned row2) const;
+
+    static bool sort(SortTask & task, const std::atomic<uint32_t> & generation);
+
+    void applySort();
+
+    void setRows(std::vector<unsigned> & result);
+};
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <atomic>
+#include <functional>
+#include <utility>
+
+constexpr uint32_t POSTED_TASKS_MAX = 32;
+
+// Bounded lock-free queue with many producers and a single consumer. Each
+// cell has a sequence number telling whether it is free for the producer of
+// a given position or ready for the consumer
+template <class T, uint32_t N>
+class TaskQueue
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+  public:
+    TaskQueue()
+    {
+      for (uint32_t i = 0; i < N; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    TaskQueue(const TaskQueue &) = delete;
+
+    TaskQueue & operator=(const TaskQueue &) = delete;
+
+    // from any thread, returns false when the queue is full
+    bool push(T value)
+    {
+      Cell * cell;
+      uint32_t position = tail.load(std::memory_order_relaxed);
+      while (true) {
+        cell = &cells[position & (N - 1)];
+        auto diff = int32_t(cell->sequence.load(std::memory_order_acquire) - position);
+        if (diff == 0) {
+          if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            break;
+        }
+        else if (diff < 0) {
+          return false;
+        }
+        else {
+          position = tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      cell->value = std::move(value);
+      cell->sequence.store(position + 1, std::memory_order_release);
+      return true;
+    }
+
+    // from the consumer thread only
+    bool pop(T & value)
+    {
+      Cell & cell = cells[head & (N - 1)];
+      if (int32_t(cell.sequence.load(std::memory_order_acquire) - (head + 1)) < 0)
+        return false;
+
+      value = std::move(cell.value);
+      cell.value = T();
+      cell.sequence.store(head + N, std::memory_order_release);
+      head++;
+      return true;
+    }
+
+    // from the consumer thread only
+    bool empty() const
+    {
+      const Cell & cell = cells[head & (N - 1)];
+      return int32_t(cell.sequence.load(std::memory_order_acquire) - (head + 1)) < 0;
+    }
+
+  protected:
+    struct Cell {
+      std::atomic<uint32_t> sequence;
+      T value;
+    };
+    Cell cells[N];
+    std::atomic<uint32_t> tail { 0 };
+    uint32_t head = 0;
+};
+
+// From any thread: runs the task on the UI thread, at the start of the next
+// MainWindow::run(). Returns false when the queue is full
+bool postToMainWindow(std::function<void()> task);
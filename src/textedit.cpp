@@ -243,6 +243,27 @@ void TextEdit::onEvent(event_t event)
 #endif
 }
 
+#if defined(HARDWARE_KEYS)
+void TextEdit::onInputEvent(const InputEvent & input)
+{
+  if (editMode && (input.event == EVT_ROTARY_RIGHT || input.event == EVT_ROTARY_LEFT)) {
+    int c = value[cursorPos];
+    int v = c;
+    for (int i = 0; i < input.count * ROTARY_ENCODER_SPEED(); i++) {
+      v = (input.event == EVT_ROTARY_RIGHT ? getNextChar(v) : getPreviousChar(v));
+    }
+    if (c != v) {
+      value[cursorPos] = v;
+      invalidate();
+      changed = true;
+    }
+  }
+  else {
+    FormField::onInputEvent(input);
+  }
+}
+#endif
+
 #if defined(HARDWARE_TOUCH)
 bool TextEdit::onTouchEnd(coord_t x, coord_t y)
 {
@@ -56,6 +56,10 @@ class TextEdit : public FormField {
 
     void onEvent(event_t event) override;
 
+#if defined(HARDWARE_KEYS)
+    void onInputEvent(const InputEvent & input) override;
+#endif
+
 #if defined(HARDWARE_TOUCH)
     bool onTouchEnd(coord_t x, coord_t y) override;
 #endif
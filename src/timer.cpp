@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "timer.h"
+#include "mainwindow.h"
+
+constexpr uint32_t TIMER_RESOLUTION_TICKS = TIMER_RESOLUTION_MS * SYSTEM_TICKS_1MS;
+
+Timer::Timer(Window * owner, std::function<void()> handler):
+  owner(owner),
+  handler(std::move(handler))
+{
+  if (owner) {
+    nextOfOwner = owner->timers;
+    owner->timers = this;
+  }
+}
+
+Timer::~Timer()
+{
+  stop();
+
+  if (owner) {
+    for (Timer ** timer = &owner->timers; *timer; timer = &(*timer)->nextOfOwner) {
+      if (*timer == this) {
+        *timer = nextOfOwner;
+        break;
+      }
+    }
+  }
+}
+
+void Timer::start(uint32_t ms, bool periodic)
+{
+  stop();
+  if (owner && owner->deleted())
+    return;
+  uint32_t ticks = max<uint32_t>(1, (ms + TIMER_RESOLUTION_MS - 1) / TIMER_RESOLUTION_MS);
+  period = periodic ? ticks : 0;
+  MainWindow::instance()->getTimerWheel().schedule(this, ticks);
+}
+
+void Timer::stop()
+{
+  if (wheel) {
+    wheel->cancel(this);
+  }
+}
+
+void TimerWheel::schedule(Timer * timer, uint32_t ticks)
+{
+  if (!started) {
+    lastAdvance = ticksNow();
+    started = true;
+  }
+  timer->wheel = this;
+  timer->expiry = current + ticks;
+  insert(timer);
+  count++;
+}
+
+void TimerWheel::insert(Timer * timer)
+{
+  uint32_t delta = timer->expiry - current;
+  uint8_t level = 0;
+  while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (TIMER_WHEEL_SLOTS << (level * TIMER_WHEEL_BITS))) {
+    level++;
+  }
+
+  // a timer further than the range of the wheel is inserted again each time its slot is reached
+  Timer * & slot = slots[level][(timer->expiry >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1)];
+  timer->link = &slot;
+  timer->next = slot;
+  if (slot) {
+    slot->link = &timer->next;
+  }
+  slot = timer;
+}
+
+void TimerWheel::cancel(Timer * timer)
+{
+  *timer->link = timer->next;
+  if (timer->next) {
+    timer->next->link = timer->link;
+  }
+  timer->wheel = nullptr;
+  timer->link = nullptr;
+  timer->next = nullptr;
+  count--;
+}
+
+void TimerWheel::cascade(uint8_t level)
+{
+  Timer * & slot = slots[level][(current >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1)];
+  Timer * timer = slot;
+  slot = nullptr;
+  while (timer) {
+    Timer * next = timer->next;
+    insert(timer);
+    timer = next;
+  }
+}
+
+void TimerWheel::advance(uint32_t now)
+{
+  if (!started) {
+    lastAdvance = now;
+    started = true;
+    return;
+  }
+
+  uint32_t elapsed = (now - lastAdvance) / TIMER_RESOLUTION_TICKS;
+  lastAdvance += elapsed * TIMER_RESOLUTION_TICKS;
+
+  if (count == 0) {
+    current += elapsed;
+    return;
+  }
+
+  while (elapsed--) {
+    current++;
+
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+      if (current & ((1u << (level * TIMER_WHEEL_BITS)) - 1))
+        break;
+      cascade(level);
+    }
+
+    Timer * & slot = slots[0][current & (TIMER_WHEEL_SLOTS - 1)];
+    while (slot) {
+      Timer * timer = slot;
+      cancel(timer);
+      if (timer->period) {
+        timer->wheel = this;
+        timer->expiry += timer->period;
+        if (int32_t(timer->expiry - current) <= 0) {
+          timer->expiry = current + timer->period;
+        }
+        insert(timer);
+        count++;
+      }
+      // the handler may stop or restart any timer, this one included
+      if (timer->handler) {
+        timer->handler();
+      }
+    }
+  }
+}
+
+bool TimerWheel::getNextExpiry(uint32_t & ticks) const
+{
+  if (count == 0)
+    return false;
+
+  // the slots of the upper levels give the time at which their timers are
+  // cascaded, which is not later than their expiry
+  uint32_t next = 0;
+  for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    uint8_t shift = level * TIMER_WHEEL_BITS;
+    for (uint32_t i = 1; i <= TIMER_WHEEL_SLOTS; i++) {
+      uint32_t tick = ((current >> shift) + i) << shift;
+      if (slots[level][(tick >> shift) & (TIMER_WHEEL_SLOTS - 1)]) {
+        if (next == 0 || tick - current < next - current) {
+          next = tick;
+        }
+        break;
+      }
+    }
+  }
+
+  ticks = lastAdvance + (next - current) * TIMER_RESOLUTION_TICKS;
+  return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <functional>
+#include <utility>
+
+class Window;
+class TimerWheel;
+
+constexpr uint32_t TIMER_RESOLUTION_MS = 10;
+constexpr uint8_t TIMER_WHEEL_LEVELS = 4;
+constexpr uint8_t TIMER_WHEEL_BITS = 6;
+constexpr uint32_t TIMER_WHEEL_SLOTS = 1u << TIMER_WHEEL_BITS;
+
+// One-shot or periodic timer run from MainWindow::run(). When it belongs
+// to a window it is stopped by Window::deleteLater()
+class Timer
+{
+  friend class TimerWheel;
+  friend class Window;
+
+  public:
+    explicit Timer(Window * owner = nullptr, std::function<void()> handler = nullptr);
+
+    Timer(const Timer &) = delete;
+
+    Timer & operator=(const Timer &) = delete;
+
+    ~Timer();
+
+    void setHandler(std::function<void()> value)
+    {
+      handler = std::move(value);
+    }
+
+    void start(uint32_t ms, bool periodic = false);
+
+    void stop();
+
+    bool isRunning() const
+    {
+      return wheel != nullptr;
+    }
+
+  protected:
+    Window * owner;
+    Timer * nextOfOwner = nullptr;
+    std::function<void()> handler;
+    TimerWheel * wheel = nullptr;
+    Timer ** link = nullptr; // the pointer to this timer in its slot
+    Timer * next = nullptr;
+    uint32_t expiry = 0; // in wheel ticks
+    uint32_t period = 0; // in wheel ticks, 0 for one-shot timers
+};
+
+// Hierarchical timer wheel: each level has 64 slots, a slot of a level
+// covering a whole turn of the level below. Timers are moved down a level
+// when its slot is reached, so that starting, stopping and advancing one
+// tick is done in constant time
+class TimerWheel
+{
+  public:
+    void schedule(Timer * timer, uint32_t ticks);
+
+    void cancel(Timer * timer);
+
+    // runs the expired timers, now is a ticksNow() value
+    void advance(uint32_t now);
+
+    // returns false when no timer is running
+    bool getNextExpiry(uint32_t & ticks) const;
+
+    bool empty() const
+    {
+      return count == 0;
+    }
+
+  protected:
+    Timer * slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS] = {};
+    uint32_t current = 0;    // in wheel ticks
+    uint32_t lastAdvance = 0; // in ticksNow() ticks
+    uint32_t count = 0;
+    bool started = false;
+
+    void insert(Timer * timer);
+
+    void cascade(uint8_t level);
+};
@@ -18,12 +18,18 @@
  */
 
 #include "window.h"
+#include "timer.h"
 #include "touch.h"
 
 Window * Window::focusWindow = nullptr;
+InputQueue Window::inputQueue;
 Window * Window::slidingWindow = nullptr;
 Window * Window::capturedWindow = nullptr;
+Window * Window::slideTarget = nullptr;
 std::list<Window *> Window::trash;
+uint32_t Window::layoutVersion = 1;
+bool Window::animating = false;
+std::vector<Window::PendingInvalidation> Window::invalidationQueue;
 
 Window::Window(Window * parent, const rect_t & rect, WindowFlags windowFlags, LcdFlags textFlags):
   parent(parent),
@@ -33,6 +39,11 @@ Window::Window(Window * parent, const rect_t & rect, WindowFlags windowFlags, Lc
   windowFlags(windowFlags),
   textFlags(textFlags)
 {
+  if (windowFlags & REFRESH_ALWAYS) {
+    eventInterest |= EVENT_INTEREST_TIMERS;
+  }
+  subtreeInterest = eventInterest;
+
   if (parent) {
     parent->addChild(this, windowFlags & PUSH_FRONT);
     if (!(windowFlags & TRANSPARENT)) {
@@ -45,18 +56,34 @@ Window::~Window()
 {
   TRACE_WINDOWS("Destroy %p %s", this, getWindowDebugString().c_str());
 
+  layoutVersion++;
+
+  if (pendingInvalidation >= 0) {
+    for (auto & entry: invalidationQueue) {
+      if (entry.window == this) {
+        entry.window = nullptr;
+      }
+    }
+  }
+
   if (focusWindow == this) {
-    focusWindow = nullptr;
+    setFocusWindow(nullptr);
   }
 
   deleteChildren();
+
+  delete refreshTimer;
+  delete hitIndex;
 }
 
 void Window::attach(Window * newParent)
 {
   if (parent) detach();
   parent = newParent;
-  if (newParent) newParent->addChild(this);
+  if (newParent) {
+    newParent->addChild(this);
+    invalidate();
+  }
 }
 
 void Window::detach()
@@ -76,8 +103,16 @@ void Window::deleteLater(bool detach, bool trash)
 
   _deleted = true;
 
+  for (auto timer = timers; timer; timer = timer->nextOfOwner) {
+    timer->stop();
+  }
+
   if (static_cast<Window *>(focusWindow) == static_cast<Window *>(this)) {
-    focusWindow = nullptr;
+    setFocusWindow(nullptr);
+  }
+
+  if (slideTarget == this) {
+    slideTarget = nullptr;
   }
 
   if (detach)
@@ -96,29 +131,128 @@ void Window::deleteLater(bool detach, bool trash)
   }
 }
 
+void Window::setRefreshPeriod(uint32_t ms)
+{
+  if (!refreshTimer) {
+    refreshTimer = new Timer(this, [=]() {
+      invalidate();
+    });
+  }
+
+  if (ms)
+    refreshTimer->start(ms, true);
+  else
+    refreshTimer->stop();
+}
+
 void Window::clear()
 {
   scrollPositionX = 0;
   scrollPositionY = 0;
   innerWidth = rect.w;
   innerHeight = rect.h;
+  invalidateLayout();
   deleteChildren();
   invalidate();
 }
 
 void Window::deleteChildren()
 {
-  for (auto window: children) {
-    window->deleteLater(false);
+  // the close handlers may add windows
+  lockChildren();
+  for (size_t i = 0; i < children.size(); i++) {
+    auto window = children[i];
+    if (window) {
+      window->deleteLater(false);
+    }
+  }
+  childrenLocked--;
+  removeChildren();
+}
+
+void Window::removeChildren()
+{
+  if (childrenLocked) {
+    std::fill(children.begin(), children.end(), nullptr);
+    hasTombstones = true;
+  }
+  else {
+    children.clear();
+    hitIndexValid = false;
+  }
+  invalidateLayout();
+  updateSubtreeInterest();
+}
+
+void Window::unlockChildren()
+{
+  if (--childrenLocked == 0 && hasTombstones) {
+    children.erase(std::remove(children.begin(), children.end(), nullptr), children.end());
+    hasTombstones = false;
+    hitIndexValid = false;
   }
-  children.clear();
 }
 
 void Window::clearFocus()
 {
   if (focusWindow) {
     focusWindow->onFocusLost();
-    focusWindow = nullptr;
+    setFocusWindow(nullptr);
+  }
+}
+
+void Window::setFocusWindow(Window * window)
+{
+  if (focusWindow) {
+    focusWindow->setEventInterest(EVENT_INTEREST_FOCUS, false);
+  }
+  focusWindow = window;
+  if (window) {
+    window->setEventInterest(EVENT_INTEREST_FOCUS, true);
+  }
+}
+
+void Window::setEventInterest(EventInterest interest, bool enabled)
+{
+  if (enabled) {
+    eventInterest |= interest;
+    addSubtreeInterest(interest);
+  }
+  else if (eventInterest & interest) {
+    eventInterest &= ~interest;
+    updateSubtreeInterest();
+  }
+}
+
+void Window::addSubtreeInterest(EventInterest interest)
+{
+  for (Window * window = this; window && (window->subtreeInterest | interest) != window->subtreeInterest; window = window->parent) {
+    window->subtreeInterest |= interest;
+  }
+}
+
+void Window::updateSubtreeInterest()
+{
+  for (Window * window = this; window; window = window->parent) {
+    EventInterest value = window->eventInterest;
+    for (auto child: window->children) {
+      if (child) {
+        value |= child->subtreeInterest;
+      }
+    }
+    if (value == window->subtreeInterest) {
+      break;
+    }
+    EventInterest added = value & ~window->subtreeInterest;
+    EventInterest removed = window->subtreeInterest & ~value;
+    window->subtreeInterest = value;
+    // nothing changes above when the parent keeps the removed interests itself
+    if (window->parent && (window->parent->eventInterest & removed) == removed) {
+      if (added) {
+        window->parent->addSubtreeInterest(added);
+      }
+      break;
+    }
   }
 }
 
@@ -141,7 +275,7 @@ void Window::setFocus(uint8_t flag, Window * from)
     }
 
     clearFocus();
-    focusWindow = this;
+    setFocusWindow(this);
     if (focusHandler) {
       focusHandler(true);
     }
@@ -152,8 +286,10 @@ void Window::setScrollPositionX(coord_t value)
 {
   auto newScrollPosition = max<coord_t>(0, min<coord_t>(innerWidth - width(), value));
   if (newScrollPosition != scrollPositionX) {
+    coord_t delta = scrollPositionX - newScrollPosition;
     scrollPositionX = newScrollPosition;
-    invalidate();
+    invalidateLayout();
+    invalidateScroll(delta, 0);
   }
 }
 
@@ -166,11 +302,104 @@ void Window::setScrollPositionY(coord_t value)
   }
 
   if (newScrollPosition != scrollPositionY) {
+    coord_t delta = scrollPositionY - newScrollPosition;
     scrollPositionY = newScrollPosition;
-    invalidate();
+    invalidateLayout();
+    invalidateScroll(0, delta);
+  }
+}
+
+void Window::moveTo(coord_t x, coord_t y)
+{
+  coord_t dx = x - rect.x;
+  coord_t dy = y - rect.y;
+  const rect_t oldRect = rect;
+
+  rect.x = x;
+  rect.y = y;
+  invalidateLayout();
+
+  // a parent painting over its children has to repaint the area anyway
+  if ((dx || dy) && parent && (windowFlags & OPAQUE) && !(parent->windowFlags & PAINT_CHILDREN_FIRST)) {
+    const rect_t movedArea = {min(oldRect.x, x), min(oldRect.y, y), rect.w + abs(dx), rect.h + abs(dy)};
+    if (!hasSiblingAbove(movedArea) &&
+        parent->blit({oldRect.x - parent->scrollPositionX, oldRect.y - parent->scrollPositionY, rect.w, rect.h}, dx, dy)) {
+      // what was under the old position has to be repainted
+      parent->invalidateUncovered({oldRect.x - parent->scrollPositionX, oldRect.y - parent->scrollPositionY, rect.w, rect.h}, dx, dy);
+      return;
+    }
+  }
+
+  invalidate();
+}
+
+bool Window::blit(const rect_t & area, coord_t dx, coord_t dy)
+{
+  if (!parent || (parent->windowFlags & PAINT_CHILDREN_FIRST))
+    return false;
+
+  const rect_t viewport = {0, 0, rect.w, rect.h};
+  if (!viewport.contains(area) || !viewport.contains({area.x + dx, area.y + dy, area.w, area.h}))
+    return false;
+
+  // windows above would be moved with the area
+  if (hasSiblingAbove({rect.x + min(area.x, area.x + dx), rect.y + min(area.y, area.y + dy), area.w + abs(dx), area.h + abs(dy)}))
+    return false;
+
+  return parent->blit({rect.x + area.x - parent->scrollPositionX, rect.y + area.y - parent->scrollPositionY, area.w, area.h}, dx, dy);
+}
+
+bool Window::hasSiblingAbove(const rect_t & area) const
+{
+  for (auto rit = parent->children.rbegin(); rit != parent->children.rend(); rit++) {
+    auto sibling = *rit;
+    if (sibling == this) {
+      return false;
+    }
+    if (sibling && sibling->rect.intersects(area)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Window::invalidateUncovered(const rect_t & area, coord_t dx, coord_t dy)
+{
+  if (dy > 0) {
+    invalidate({area.x, area.y, area.w, min(dy, area.h)});
+  }
+  else if (dy < 0) {
+    invalidate({area.x, area.bottom() - min(-dy, area.h), area.w, min(-dy, area.h)});
+  }
+
+  if (dx > 0) {
+    invalidate({area.x, area.y, min(dx, area.w), area.h});
+  }
+  else if (dx < 0) {
+    invalidate({area.right() - min(-dx, area.w), area.y, min(-dx, area.w), area.h});
   }
 }
 
+void Window::invalidateScroll(coord_t dx, coord_t dy)
+{
+  if ((windowFlags & OPAQUE) && abs(dx) < rect.w && abs(dy) < rect.h) {
+    const rect_t viewport = {0, 0, rect.w, rect.h};
+    if (blit({max<coord_t>(0, -dx), max<coord_t>(0, -dy), rect.w - abs(dx), rect.h - abs(dy)}, dx, dy)) {
+      invalidateUncovered(viewport, dx, dy);
+      if (dy && !(windowFlags & NO_SCROLLBAR) && innerHeight > rect.h) {
+        // the scrollbar has been moved with the content
+        invalidate({rect.w - SCROLLBAR_WIDTH - scrollPositionX, 0, SCROLLBAR_WIDTH, rect.h});
+      }
+      if (dx && !(windowFlags & NO_SCROLLBAR) && innerWidth > rect.w) {
+        invalidate({0, rect.h - SCROLLBAR_WIDTH - scrollPositionY, rect.w, SCROLLBAR_WIDTH});
+      }
+      return;
+    }
+  }
+
+  invalidate();
+}
+
 void Window::scrollTo(Window * child)
 {
   coord_t offsetX = 0;
@@ -210,68 +439,44 @@ void Window::scrollTo(const rect_t & rect)
   }
 }
 
-bool Window::hasOpaqueRect(const rect_t & testRect) const
+const rect_t & Window::getOpaqueRect()
 {
-  if (!rect.contains(testRect))
-    return false;
-
-  if (windowFlags & OPAQUE) {
-    return true;
-  }
-
-  rect_t relativeRect = {testRect.x - rect.x, testRect.y - rect.y, testRect.w, testRect.h};
-  for (auto child: children) {
-    if (child->hasOpaqueRect(relativeRect))
-      return true;
-  }
-
-  return false;
-}
-
-void Window::fullPaint(BitmapBuffer * dc)
-{
-  bool paintNeeded = true;
-  std::list<Window *>::iterator firstChild;
-
-  coord_t xmin, xmax, ymin, ymax;
-  dc->getClippingRect(xmin, xmax, ymin, ymax);
-  coord_t x = dc->getOffsetX();
-  coord_t y = dc->getOffsetY();
-
-  if (windowFlags & PAINT_CHILDREN_FIRST) {
-    paintChildren(dc, children.begin());
-    dc->setOffset(x, y);
-    dc->setClippingRect(xmin, xmax, ymin, ymax);
-  }
-  else {
-    firstChild = children.end();
-    rect_t relativeRect = {xmin - x, ymin - y, xmax - xmin, ymax - ymin};
-    while (firstChild != children.begin()) {
-      auto child = *(--firstChild);
-      if (child->hasOpaqueRect(relativeRect)) {
-        paintNeeded = false;
-        break;
+  if (!opaqueRectValid) {
+    opaqueRectValid = true;
+    if (windowFlags & OPAQUE) {
+      opaqueRect = rect;
+    }
+    else {
+      opaqueRect = {0, 0, 0, 0};
+      for (auto child: children) {
+        if (!child)
+          continue;
+        const rect_t & childRect = child->getOpaqueRect();
+        if (childRect.w > 0 && childRect.h > 0) {
+          rect_t result = rect.intersection({rect.x + childRect.x - scrollPositionX, rect.y + childRect.y - scrollPositionY, childRect.w, childRect.h});
+          if (result.area() > opaqueRect.area()) {
+            opaqueRect = result;
+          }
+        }
       }
     }
   }
+  return opaqueRect;
+}
 
-  if (paintNeeded) {
-    TRACE_WINDOWS_INDENT("%s%s", getWindowDebugString().c_str(), hasFocus() ? " (*)" : "");
-    paint(dc);
-#if defined(WINDOWS_INSPECT_BORDER_COLOR)
-    dc->drawSolidRect(0, 0, width(), height(), 1, WINDOWS_INSPECT_BORDER_COLOR);
-#endif
-  }
-  else {
-    TRACE_WINDOWS_INDENT("%s (skipped)", getWindowDebugString().c_str());
-  }
+void Window::invalidateLayout()
+{
+  layoutVersion++;
 
-  if (!(windowFlags & NO_SCROLLBAR)) {
-    drawVerticalScrollbar(dc);
+  if (parent) {
+    parent->hitIndexValid = false;
   }
 
-  if (!(windowFlags & PAINT_CHILDREN_FIRST)) {
-    paintChildren(dc, firstChild);
+  // an invalid summary means that the ancestors depending on it are already invalid
+  Window * window = this;
+  while (window && window->opaqueRectValid) {
+    window->opaqueRectValid = false;
+    window = window->parent;
   }
 }
 
@@ -287,7 +492,7 @@ bool Window::isChildVisible(const Window * window) const
     if (child == window) {
       return true;
     }
-    if ((child->getWindowFlags() & OPAQUE) & isChildFullSize(child)) {
+    if (child && (child->getWindowFlags() & OPAQUE) && isChildFullSize(child)) {
       return false;
     }
   }
@@ -306,35 +511,78 @@ void Window::setInsideParentScrollingArea()
   }
 }
 
-void Window::paintChildren(BitmapBuffer * dc, std::list<Window *>::iterator it)
+void Window::paintWindow(BitmapBuffer * dc)
 {
-  coord_t x = dc->getOffsetX();
-  coord_t y = dc->getOffsetY();
-  coord_t xmin, xmax, ymin, ymax;
-  dc->getClippingRect(xmin, xmax, ymin, ymax);
+  TRACE_WINDOWS_INDENT("%s%s", getWindowDebugString().c_str(), hasFocus() ? " (*)" : "");
+  paint(dc);
+#if defined(WINDOWS_INSPECT_BORDER_COLOR)
+  dc->drawSolidRect(0, 0, width(), height(), 1, WINDOWS_INSPECT_BORDER_COLOR);
+#endif
 
-  for (; it != children.end(); it++) {
-    auto child = *it;
+  if (!(windowFlags & NO_SCROLLBAR)) {
+    drawVerticalScrollbar(dc);
+  }
+}
 
-    coord_t child_xmin = x + child->rect.x;
-    if (child_xmin >= xmax)
-      continue;
-    coord_t child_ymin = y + child->rect.y;
-    if (child_ymin >= ymax)
-      continue;
-    coord_t child_xmax = child_xmin + child->rect.w;
-    if (child_xmax <= xmin)
+void Window::hideCoveredChildren(std::vector<Window *>::iterator it, const rect_t & clipRect)
+{
+  // children hidden by an opaque sibling painted later are marked to be skipped
+  rect_t coveredRect = {0, 0, 0, 0};
+  for (auto rit = children.rbegin(); rit != std::vector<Window *>::reverse_iterator(it); rit++) {
+    auto child = *rit;
+    if (!child)
       continue;
-    coord_t child_ymax = child_ymin + child->rect.h;
-    if (child_ymax <= ymin)
+    child->hiddenBySibling = coveredRect.contains(child->rect.intersection(clipRect));
+    rect_t opaqueRect = child->getOpaqueRect().intersection(clipRect);
+    if (opaqueRect.area() > coveredRect.area()) {
+      coveredRect = opaqueRect;
+    }
+  }
+}
+
+void Window::buildRenderList(std::vector<RenderEntry> & list, coord_t x, coord_t y, const rect_t & clipRect)
+{
+  const RenderEntry entry = {this, clipRect.left(), clipRect.right(), clipRect.top(), clipRect.bottom(), x, y};
+
+  if (!(windowFlags & PAINT_CHILDREN_FIRST)) {
+    list.push_back(entry);
+  }
+
+  hideCoveredChildren(children.begin(), {clipRect.x - x, clipRect.y - y, clipRect.w, clipRect.h});
+
+  for (auto child: children) {
+    if (!child || child->hiddenBySibling)
       continue;
+    rect_t childClipRect = clipRect.intersection({x + child->rect.x, y + child->rect.y, child->rect.w, child->rect.h});
+    if (childClipRect.w > 0 && childClipRect.h > 0) {
+      child->buildRenderList(list, x + child->rect.x - child->scrollPositionX, y + child->rect.y - child->scrollPositionY, childClipRect);
+    }
+  }
 
-    dc->setOffset(x + child->rect.x - child->scrollPositionX, y + child->rect.y - child->scrollPositionY);
-    dc->setClippingRect(max(xmin, x + child->rect.left()),
-                        min(xmax, x + child->rect.right()),
-                        max(ymin, y + child->rect.top()),
-                        min(ymax, y + child->rect.bottom()));
-    child->fullPaint(dc);
+  if (windowFlags & PAINT_CHILDREN_FIRST) {
+    list.push_back(entry);
+  }
+}
+
+void Window::paintRenderList(BitmapBuffer * dc, const std::vector<RenderEntry> & list, const rect_t & rect)
+{
+  // what is listed before the last opaque window covering the rect is hidden
+  size_t first = 0;
+  for (size_t i = list.size(); i > 0; i--) {
+    const RenderEntry & entry = list[i - 1];
+    if ((entry.window->windowFlags & OPAQUE) && entry.covers(rect)) {
+      first = i - 1;
+      break;
+    }
+  }
+
+  for (size_t i = first; i < list.size(); i++) {
+    const RenderEntry & entry = list[i];
+    if (!entry.intersects(rect))
+      continue;
+    dc->setOffset(entry.offsetX, entry.offsetY);
+    dc->setClippingRect(max(entry.xmin, rect.left()), min(entry.xmax, rect.right()), max(entry.ymin, rect.top()), min(entry.ymax, rect.bottom()));
+    entry.window->paintWindow(dc);
   }
 }
 
@@ -361,17 +609,24 @@ coord_t Window::getSnapStep(coord_t relativeScrollPosition, coord_t pageSize)
 
 void Window::checkEvents()
 {
-  auto copy = children;
-  for (auto child: copy) {
-    if (!child->deleted()) {
+  // subtrees without anything to check are skipped, windows deleted or
+  // added meanwhile are handled through tombstones instead of a copy
+  lockChildren();
+  for (size_t i = 0; i < children.size(); i++) {
+    auto child = children[i];
+    if (child && child->subtreeInterest && !child->deleted()) {
+      auto insertions = frontInsertions;
       child->checkEvents();
+      // the windows inserted in front meanwhile shift the current one
+      i += uint16_t(frontInsertions - insertions);
     }
   }
+  unlockChildren();
 
   if (this == Window::focusWindow) {
-    event_t event = getWindowEvent();
-    if (event) {
-      this->onEvent(event);
+    InputEvent input;
+    if (inputQueue.pop(input)) {
+      this->onInputEvent(input);
     }
   }
 
@@ -385,18 +640,52 @@ void Window::checkEvents()
       coord_t relativeScrollPosition = getScrollPositionX() % pageWidth;
       if (relativeScrollPosition) {
         setScrollPositionX(getScrollPositionX() + getSnapStep(relativeScrollPosition, pageWidth));
+        animating = true;
       }
     }
     if (pageHeight) {
       coord_t relativeScrollPosition = getScrollPositionY() % pageHeight;
       if (relativeScrollPosition) {
         setScrollPositionY(getScrollPositionY() + getSnapStep(relativeScrollPosition, pageHeight));
+        animating = true;
       }
     }
   }
 #endif
 }
 
+#if defined(DEBUG_WINDOWS) || defined(TESTS)
+const Window * Window::findPollingWindow() const
+{
+  if (eventInterest & (EVENT_INTEREST_DYNAMIC | EVENT_INTEREST_TIMERS)) {
+    return this;
+  }
+
+  if (subtreeInterest & (EVENT_INTEREST_DYNAMIC | EVENT_INTEREST_TIMERS)) {
+    for (auto child: children) {
+      auto result = child ? child->findPollingWindow() : nullptr;
+      if (result) {
+        return result;
+      }
+    }
+  }
+
+  return nullptr;
+}
+#endif
+
+void Window::onInputEvent(const InputEvent & input)
+{
+  for (uint16_t i = 0; i < input.count; i++) {
+    if (focusWindow != this) {
+      // the remaining steps go to the new focused window
+      inputQueue.pushFront({input.event, uint16_t(input.count - i), input.timestamp});
+      return;
+    }
+    onEvent(input.event);
+  }
+}
+
 void Window::onEvent(event_t event)
 {
   TRACE_WINDOWS("%s received event 0x%X", Window::getWindowDebugString("Window").c_str(), event);
@@ -405,19 +694,74 @@ void Window::onEvent(event_t event)
   }
 }
 
-#if defined(HARDWARE_TOUCH)
-bool Window::onTouchStart(coord_t x, coord_t y)
+void Window::buildHitIndex()
 {
-  for (auto it = children.rbegin(); it != children.rend(); ++it) {
-    auto child = *it;
-    if (child->rect.contains(x, y)) {
-      if (child->onTouchStart(x - child->rect.x + child->scrollPositionX, y - child->rect.y + child->scrollPositionY)) {
-        return true;
+  if (!hitIndex) {
+    hitIndex = new HitIndex();
+  }
+
+  coord_t top = INT32_MAX;
+  coord_t bottom = INT32_MIN;
+  coord_t totalHeight = 0;
+  uint32_t count = 0;
+  for (auto child: children) {
+    if (child && child->rect.w > 0 && child->rect.h > 0) {
+      top = min(top, child->rect.top());
+      bottom = max(bottom, child->rect.bottom());
+      totalHeight += child->rect.h;
+      count++;
+    }
+  }
+
+  hitIndexValid = true;
+  hitIndex->items.clear();
+  if (count == 0) {
+    hitIndex->top = 0;
+    hitIndex->bandHeight = 1;
+    hitIndex->bandStart.assign(1, 0);
+    return;
+  }
+
+  // bands of the average height of the children, most of them are then in 1 or 2 bands
+  coord_t bandHeight = max<coord_t>(8, totalHeight / count);
+  if (uint32_t((bottom - top + bandHeight - 1) / bandHeight) > HIT_INDEX_MAX_BANDS) {
+    bandHeight = (bottom - top + HIT_INDEX_MAX_BANDS - 1) / HIT_INDEX_MAX_BANDS;
+  }
+  uint32_t bands = (bottom - top + bandHeight - 1) / bandHeight;
+  hitIndex->top = top;
+  hitIndex->bandHeight = bandHeight;
+
+  auto & bandStart = hitIndex->bandStart;
+  bandStart.assign(bands + 1, 0);
+  for (auto child: children) {
+    if (child && child->rect.w > 0 && child->rect.h > 0) {
+      for (coord_t band = (child->rect.top() - top) / bandHeight; band <= (child->rect.bottom() - 1 - top) / bandHeight; band++) {
+        bandStart[band + 1]++;
       }
     }
   }
+  for (uint32_t band = 0; band < bands; band++) {
+    bandStart[band + 1] += bandStart[band];
+  }
 
-  return false;
+  hitIndex->items.resize(bandStart[bands]);
+  std::vector<uint32_t> position(bandStart.begin(), bandStart.end() - 1);
+  for (size_t i = 0; i < children.size(); i++) {
+    auto child = children[i];
+    if (child && child->rect.w > 0 && child->rect.h > 0) {
+      for (coord_t band = (child->rect.top() - top) / bandHeight; band <= (child->rect.bottom() - 1 - top) / bandHeight; band++) {
+        hitIndex->items[position[band]++] = i;
+      }
+    }
+  }
+}
+
+#if defined(HARDWARE_TOUCH)
+bool Window::onTouchStart(coord_t x, coord_t y)
+{
+  return forwardToChildAt(x, y, [=](Window * child) {
+    return child->onTouchStart(x - child->rect.x + child->scrollPositionX, y - child->rect.y + child->scrollPositionY);
+  });
 }
 
 bool Window::forwardTouchEnd(coord_t x, coord_t y)
@@ -429,16 +773,9 @@ bool Window::forwardTouchEnd(coord_t x, coord_t y)
     return true;
   }
 
-  for (auto it = children.rbegin(); it != children.rend(); ++it) {
-    auto child = *it;
-    if (child->rect.contains(x, y)) {
-      if (child->onTouchEnd(x - child->rect.x + child->scrollPositionX, y - child->rect.y + child->scrollPositionY)) {
-        return true;
-      }
-    }
-  }
-
-  return false;
+  return forwardToChildAt(x, y, [=](Window * child) {
+    return child->onTouchEnd(x - child->rect.x + child->scrollPositionX, y - child->rect.y + child->scrollPositionY);
+  });
 }
 
 bool Window::onTouchEnd(coord_t x, coord_t y)
@@ -451,13 +788,19 @@ bool Window::onTouchSlide(coord_t x, coord_t y, coord_t startX, coord_t startY,
   startX += getScrollPositionX();
   startY += getScrollPositionY();
 
-  for (auto it = children.rbegin(); it != children.rend(); ++it) {
-    auto child = *it;
-    if (child->rect.contains(startX, startY)) {
-      if (child->onTouchSlide(x - child->rect.x, y - child->rect.y, startX - child->rect.x, startY - child->rect.y, slideX, slideY)) {
-        return true;
+  bool result = forwardToChildAt(startX, startY, [=](Window * child) {
+    if (child->onTouchSlide(x - child->rect.x, y - child->rect.y, startX - child->rect.x, startY - child->rect.y, slideX, slideY)) {
+      // the deepest window accepting the slide is the first one to return
+      if (!slideTarget) {
+        slideTarget = child;
       }
+      return true;
     }
+    return false;
+  });
+
+  if (result) {
+    return true;
   }
 
   if (slidingWindow && slidingWindow != this) {
@@ -478,13 +821,35 @@ bool Window::onTouchSlide(coord_t x, coord_t y, coord_t startX, coord_t startY,
 
   return false;
 }
+
+bool Window::forwardSlideToTarget(coord_t x, coord_t y, coord_t startX, coord_t startY, coord_t slideX, coord_t slideY)
+{
+  if (!slideTarget)
+    return false;
+
+  // same coordinates as if the slide had been forwarded from the root
+  for (Window * window = slideTarget; window->parent; window = window->parent) {
+    x -= window->rect.x;
+    y -= window->rect.y;
+    startX += window->parent->scrollPositionX - window->rect.x;
+    startY += window->parent->scrollPositionY - window->rect.y;
+  }
+
+  if (slideTarget->onTouchSlide(x, y, startX, startY, slideX, slideY))
+    return true;
+
+  slideTarget = nullptr;
+  return false;
+}
 #endif
 
 void Window::adjustInnerHeight()
 {
   coord_t bottomMax = 0;
   for (auto child: children) {
-    bottomMax = max(bottomMax, child->rect.y + child->rect.h);
+    if (child) {
+      bottomMax = max(bottomMax, child->rect.y + child->rect.h);
+    }
   }
   setInnerHeight(bottomMax);
 }
@@ -494,6 +859,7 @@ coord_t Window::adjustHeight()
   coord_t old = rect.h;
   adjustInnerHeight();
   rect.h = innerHeight;
+  invalidateLayout();
   return rect.h - old;
 }
 
@@ -504,8 +870,9 @@ void Window::moveWindowsTop(coord_t y, coord_t delta)
   }
 
   for (auto child: children) {
-    if (child->rect.y >= y) {
+    if (child && child->rect.y >= y) {
       child->rect.y += delta;
+      child->invalidateLayout();
       invalidate();
     }
   }
@@ -513,9 +880,79 @@ void Window::moveWindowsTop(coord_t y, coord_t delta)
 
 void Window::invalidate(const rect_t & rect)
 {
-  if (isVisible()) {
-    parent->invalidate({this->rect.x + rect.x - parent->scrollPositionX, this->rect.y + rect.y - parent->scrollPositionY, rect.w, rect.h});
+  if (!parent)
+    return;
+
+  if (pendingInvalidation >= 0) {
+    // merged with the previous invalidation of the window when they touch
+    rect_t & pendingRect = invalidationQueue[pendingInvalidation].rect;
+    if (pendingRect.contains(rect))
+      return;
+    if (pendingRect.intersects({rect.x - 1, rect.y - 1, rect.w + 2, rect.h + 2})) {
+      pendingRect = pendingRect.boundingRect(rect);
+      return;
+    }
+  }
+
+  pendingInvalidation = invalidationQueue.size();
+  invalidationQueue.push_back({this, rect});
+}
+
+void Window::updateInvalidationTarget()
+{
+  if (targetVersion == layoutVersion)
+    return;
+
+  targetVersion = layoutVersion;
+
+  if (!parent) {
+    invalidationTarget = nullptr;
+    return;
   }
+
+  if (!parent->parent || parent->catchesChildrenInvalidations()) {
+    invalidationTarget = parent;
+    targetX = rect.x - parent->scrollPositionX;
+    targetY = rect.y - parent->scrollPositionY;
+    targetClip = {0, 0, parent->rect.w, parent->rect.h};
+    visibleInTarget = true;
+  }
+  else {
+    parent->updateInvalidationTarget();
+    invalidationTarget = parent->invalidationTarget;
+    targetX = parent->targetX + rect.x - parent->scrollPositionX;
+    targetY = parent->targetY + rect.y - parent->scrollPositionY;
+    targetClip = parent->targetClip;
+    visibleInTarget = parent->visibleInTarget;
+  }
+
+  targetClip = targetClip.intersection({targetX, targetY, rect.w, rect.h});
+  visibleInTarget = visibleInTarget && parent->isChildVisible(this);
+}
+
+void Window::resolveInvalidations()
+{
+  // the invalidations of the targets are queued and resolved in the same pass
+  for (size_t i = 0; i < invalidationQueue.size(); i++) {
+    const PendingInvalidation entry = invalidationQueue[i];
+    Window * window = entry.window;
+    if (!window)
+      continue;
+
+    if (window->pendingInvalidation == int32_t(i)) {
+      window->pendingInvalidation = -1;
+    }
+
+    window->updateInvalidationTarget();
+    if (window->invalidationTarget && window->visibleInTarget) {
+      rect_t rect = window->targetClip.intersection({window->targetX + entry.rect.x, window->targetY + entry.rect.y, entry.rect.w, entry.rect.h});
+      if (rect.w > 0 && rect.h > 0) {
+        window->invalidationTarget->invalidate(rect);
+      }
+    }
+  }
+
+  invalidationQueue.clear();
 }
 
 void Window::drawVerticalScrollbar(BitmapBuffer * dc)
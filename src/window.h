@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <list>
+#include <algorithm>
+#include <vector>
 #include <string>
 #include <utility>
 #include <functional>
@@ -30,6 +32,7 @@
 #include "libopenui_defines.h"
 #include "libopenui_helpers.h"
 #include "libopenui_config.h"
+#include "input.h"
 
 typedef uint32_t WindowFlags;
 
@@ -40,6 +43,10 @@ typedef uint32_t WindowFlags;
 
 constexpr int INFINITE_HEIGHT = INT32_MAX;
 
+// containers with more children use an index for touch hit-testing
+constexpr size_t HIT_INDEX_MIN_CHILDREN = 16;
+constexpr uint32_t HIT_INDEX_MAX_BANDS = 128;
+
 constexpr WindowFlags OPAQUE =                1u << 0u;
 constexpr WindowFlags TRANSPARENT =           1u << 1u;
 constexpr WindowFlags NO_SCROLLBAR =          1u << 2u;
@@ -50,6 +57,14 @@ constexpr WindowFlags PAINT_CHILDREN_FIRST =  1u << 6u;
 constexpr WindowFlags PUSH_FRONT =  1u << 7u;
 constexpr WindowFlags WINDOW_FLAGS_LAST =  PUSH_FRONT;
 
+// what a window needs checkEvents() to be called for, subtrees without any
+// interest are skipped. Windows overriding checkEvents() keep EVENT_INTEREST_DYNAMIC
+typedef uint8_t EventInterest;
+constexpr EventInterest EVENT_INTEREST_DYNAMIC = 1u << 0u;
+constexpr EventInterest EVENT_INTEREST_TIMERS =  1u << 1u;
+constexpr EventInterest EVENT_INTEREST_PAGING =  1u << 2u;
+constexpr EventInterest EVENT_INTEREST_FOCUS =   1u << 3u;
+
 enum SetFocusFlag
 {
   SET_FOCUS_DEFAULT,
@@ -58,9 +73,99 @@ enum SetFocusFlag
   SET_FOCUS_FIRST
 };
 
+class Window;
+
+// non-copying view of the children of a window, the children removed
+// while the window is iterating them are skipped
+class ChildrenView
+{
+  public:
+    class Iterator
+    {
+      public:
+        Iterator(Window * const * current, Window * const * end):
+          current(current),
+          end(end)
+        {
+          skipRemoved();
+        }
+
+        Window * operator*() const
+        {
+          return *current;
+        }
+
+        Iterator & operator++()
+        {
+          ++current;
+          skipRemoved();
+          return *this;
+        }
+
+        Iterator operator++(int)
+        {
+          Iterator result = *this;
+          ++(*this);
+          return result;
+        }
+
+        bool operator==(const Iterator & other) const
+        {
+          return current == other.current;
+        }
+
+        bool operator!=(const Iterator & other) const
+        {
+          return current != other.current;
+        }
+
+      protected:
+        Window * const * current;
+        Window * const * end;
+
+        void skipRemoved()
+        {
+          while (current != end && !*current) {
+            ++current;
+          }
+        }
+    };
+
+    explicit ChildrenView(const std::vector<Window *> & children):
+      children(children)
+    {
+    }
+
+    Iterator begin() const
+    {
+      return Iterator(children.data(), children.data() + children.size());
+    }
+
+    Iterator end() const
+    {
+      return Iterator(children.data() + children.size(), children.data() + children.size());
+    }
+
+    bool empty() const
+    {
+      return begin() == end();
+    }
+
+    size_t size() const
+    {
+      return children.size() - std::count(children.begin(), children.end(), nullptr);
+    }
+
+  protected:
+    const std::vector<Window *> & children;
+};
+
+class Timer;
+
 class Window
 {
   friend class GridLayout;
+  friend class Timer;
 
   public:
     Window(Window * parent, const rect_t & rect, WindowFlags windowFlags = 0, LcdFlags textFlags = 0);
@@ -122,6 +227,8 @@ class Window
     void setWindowFlags(WindowFlags flags)
     {
       windowFlags = flags;
+      invalidateLayout();
+      setEventInterest(EVENT_INTEREST_TIMERS, flags & REFRESH_ALWAYS);
     }
 
     LcdFlags getTextFlags() const
@@ -144,9 +251,9 @@ class Window
       focusHandler = std::move(handler);
     }
 
-    const std::list<Window *> getChildren()
+    ChildrenView getChildren() const
     {
-      return children;
+      return ChildrenView(children);
     }
 
     virtual void deleteLater(bool detach = true, bool trash = true);
@@ -176,12 +283,14 @@ class Window
     void setRect(rect_t value)
     {
       rect = value;
+      invalidateLayout();
       invalidate();
     }
 
     void setWidth(coord_t value)
     {
       rect.w = value;
+      invalidateLayout();
       invalidate();
     }
 
@@ -189,11 +298,13 @@ class Window
     {
       rect.x = (parent->width() - width()) / 2;
       rect.y = (parent->height() - height()) / 2;
+      invalidateLayout();
     }
 
     void setHeight(coord_t value)
     {
       rect.h = value;
+      invalidateLayout();
       if (windowFlags & FORWARD_SCROLL)
         innerHeight = value;
       else if (innerHeight <= value) {
@@ -204,16 +315,17 @@ class Window
 
     void setLeft(coord_t x)
     {
-      rect.x = x;
-      invalidate();
+      moveTo(x, rect.y);
     }
 
     void setTop(coord_t y)
     {
-      rect.y = y;
-      invalidate();
+      moveTo(rect.x, y);
     }
 
+    // the pixels already on screen are moved instead of repainted when possible
+    void moveTo(coord_t x, coord_t y);
+
     coord_t left() const
     {
       return rect.x;
@@ -259,17 +371,20 @@ class Window
       innerWidth = w;
       if (width() >= w) {
         scrollPositionX = 0;
+        invalidateLayout();
       }
     }
 
     void setPageWidth(coord_t w)
     {
       pageWidth = w;
+      setEventInterest(EVENT_INTEREST_PAGING, pageWidth || pageHeight);
     }
 
     void setPageHeight(coord_t h)
     {
       pageHeight = h;
+      setEventInterest(EVENT_INTEREST_PAGING, pageWidth || pageHeight);
     }
 
     uint8_t getPageCount() const
@@ -302,6 +417,7 @@ class Window
       innerHeight = h;
       if (windowFlags & FORWARD_SCROLL) {
         rect.h = innerHeight;
+        invalidateLayout();
         parent->adjustInnerHeight();
       }
       else if (height() >= h) {
@@ -357,6 +473,10 @@ class Window
 
     virtual void onEvent(event_t event);
 
+    // receives the events of the focused window, coalesced. The default
+    // implementation calls onEvent() once per step
+    virtual void onInputEvent(const InputEvent & input);
+
     void adjustInnerHeight();
 
     coord_t adjustHeight();
@@ -384,9 +504,33 @@ class Window
       return _deleted;
     }
 
+    // invalidates the window periodically, 0 to stop. To be preferred to
+    // REFRESH_ALWAYS which invalidates it on every frame
+    void setRefreshPeriod(uint32_t ms);
+
+    // windows are polled by default so that checkEvents() overrides keep
+    // working. Containers and widgets with nothing to poll can opt out, their
+    // subtree is then only visited for the children which have interests
+    void setPollingEnabled(bool enabled)
+    {
+      setEventInterest(EVENT_INTEREST_DYNAMIC, enabled);
+    }
+
+    EventInterest getSubtreeInterest() const
+    {
+      return subtreeInterest;
+    }
+
+#if defined(DEBUG_WINDOWS) || defined(TESTS)
+    // the first window of the subtree which keeps MainWindow::getNextDeadline()
+    // polling, nullptr for a page only made of static widgets and of
+    // containers with polling disabled
+    const Window * findPollingWindow() const;
+#endif
+
   protected:
     Window * parent;
-    std::list<Window *> children;
+    std::vector<Window *> children;
     rect_t rect;
     coord_t innerWidth;
     coord_t innerHeight;
@@ -397,34 +541,160 @@ class Window
     WindowFlags windowFlags;
     LcdFlags textFlags;
     bool _deleted = false;
+    bool opaqueRectValid = false;
+    bool hiddenBySibling = false;
+    EventInterest eventInterest = EVENT_INTEREST_DYNAMIC;
+    EventInterest subtreeInterest = 0;
+    // while the children are iterated, removed children are replaced by nullptr
+    uint8_t childrenLocked = 0;
+    bool hasTombstones = false;
+    uint16_t frontInsertions = 0;
+    Timer * timers = nullptr;
+    Timer * refreshTimer = nullptr;
+
+    // the children indexes split into horizontal bands, in paint order in each band
+    struct HitIndex
+    {
+      coord_t top;
+      coord_t bandHeight;
+      std::vector<uint32_t> bandStart;
+      std::vector<uint16_t> items;
+    };
+    HitIndex * hitIndex = nullptr;
+    bool hitIndexValid = false;
+
+    // the window which accepted the current slide receives the next moves directly
+    static Window * slideTarget;
+    rect_t opaqueRect = {0, 0, 0, 0};
 
     static Window * focusWindow;
+    static InputQueue inputQueue;
     static Window * slidingWindow;
     static Window * capturedWindow;
     static std::list<Window *> trash;
 
+    // set when a window has moved one step of an animation (page snapping)
+    static bool animating;
+
+    // the invalidations are queued and resolved once per frame
+    struct PendingInvalidation
+    {
+      Window * window;
+      rect_t rect;
+    };
+    static std::vector<PendingInvalidation> invalidationQueue;
+    int32_t pendingInvalidation = -1; // index of the last entry of the window in the queue
+
+    // where the invalidations of the window go: the root or the nearest ancestor
+    // catching them, cached until the layout changes
+    uint32_t targetVersion = 0;
+    Window * invalidationTarget = nullptr;
+    coord_t targetX = 0;
+    coord_t targetY = 0;
+    rect_t targetClip = {0, 0, 0, 0};
+    bool visibleInTarget = false;
+
+    void updateInvalidationTarget();
+
+    static void resolveInvalidations();
+
+    // windows returning true receive the invalidations of their children
+    virtual bool catchesChildrenInvalidations() const
+    {
+      return false;
+    }
+
+    // incremented on every layout change, used to know when the render list is outdated
+    static uint32_t layoutVersion;
+
+    // the visible windows in paint order, with their absolute clipping and offset
+    struct RenderEntry
+    {
+      Window * window;
+      coord_t xmin, xmax, ymin, ymax;
+      coord_t offsetX, offsetY;
+
+      bool intersects(const rect_t & rect) const
+      {
+        // no early exit, the 4 comparisons are done in parallel
+        return (xmin < rect.right()) & (xmax > rect.left()) & (ymin < rect.bottom()) & (ymax > rect.top());
+      }
+
+      bool covers(const rect_t & rect) const
+      {
+        return (xmin <= rect.left()) & (xmax >= rect.right()) & (ymin <= rect.top()) & (ymax >= rect.bottom());
+      }
+    };
+
+    void buildRenderList(std::vector<RenderEntry> & list, coord_t x, coord_t y, const rect_t & clipRect);
+
+    static void paintRenderList(BitmapBuffer * dc, const std::vector<RenderEntry> & list, const rect_t & rect);
+
     std::function<void()> closeHandler;
     std::function<void(bool)> focusHandler;
 
     void addChild(Window * window, bool front = false)
     {
-      if (front)
-        children.push_front(window);
-      else
+      if (front) {
+        children.insert(children.begin(), window);
+        frontInsertions++;
+      }
+      else {
         children.push_back(window);
+      }
+      hitIndexValid = false;
+      invalidateLayout();
+      addSubtreeInterest(window->subtreeInterest);
     }
 
     void removeChild(Window * window)
     {
-      children.remove(window);
+      if (childrenLocked) {
+        std::replace(children.begin(), children.end(), window, static_cast<Window *>(nullptr));
+        hasTombstones = true;
+      }
+      else {
+        children.erase(std::remove(children.begin(), children.end(), window), children.end());
+        hitIndexValid = false;
+      }
+      invalidateLayout();
+      updateSubtreeInterest();
       invalidate();
     }
 
+    // the children are neither detached nor deleted
+    void removeChildren();
+
+    void lockChildren()
+    {
+      childrenLocked++;
+    }
+
+    void unlockChildren();
+
+    static void setFocusWindow(Window * window);
+
+    void setEventInterest(EventInterest interest, bool enabled = true);
+
+    void addSubtreeInterest(EventInterest interest);
+
+    void updateSubtreeInterest();
+
     virtual void invalidate(const rect_t & rect);
 
-    void paintChildren(BitmapBuffer * dc, std::list<Window *>::iterator it);
+    // moves pixels of an area of the window already on screen, returns false
+    // when not possible (obscured, clipped), the caller has then to invalidate
+    virtual bool blit(const rect_t & area, coord_t dx, coord_t dy);
+
+    bool hasSiblingAbove(const rect_t & area) const;
+
+    void invalidateUncovered(const rect_t & area, coord_t dx, coord_t dy);
 
-    void fullPaint(BitmapBuffer * dc);
+    void invalidateScroll(coord_t dx, coord_t dy);
+
+    void hideCoveredChildren(std::vector<Window *>::iterator it, const rect_t & clipRect);
+
+    void paintWindow(BitmapBuffer * dc);
 
     virtual void paint(BitmapBuffer *)
     {
@@ -451,6 +721,61 @@ class Window
 
     bool forwardTouchEnd(coord_t x, coord_t y);
 
-    bool hasOpaqueRect(const rect_t & testRect) const;
+    void buildHitIndex();
+
+    // calls the handler for the children containing the point, the topmost
+    // first, until it returns true
+    // the handler is a template parameter to avoid a std::function allocation
+    // on each touch sample
+    template <class F>
+    bool forwardToChildAt(coord_t x, coord_t y, F && handler);
+
+#if defined(HARDWARE_TOUCH)
+    static bool forwardSlideToTarget(coord_t x, coord_t y, coord_t startX, coord_t startY, coord_t slideX, coord_t slideY);
+#endif
+
+    // largest rect of the window fully covered by itself or its descendants,
+    // in parent coordinates. Cached until the layout of the subtree changes
+    const rect_t & getOpaqueRect();
+
+    // to be called when the geometry, the flags, the scroll position or the
+    // children of the window change
+    void invalidateLayout();
 };
 
+template <class F>
+bool Window::forwardToChildAt(coord_t x, coord_t y, F && handler)
+{
+  bool result = false;
+
+  lockChildren();
+  if (children.size() >= HIT_INDEX_MIN_CHILDREN && children.size() <= UINT16_MAX) {
+    if (!hitIndexValid) {
+      buildHitIndex();
+    }
+    if (y >= hitIndex->top) {
+      uint32_t band = (y - hitIndex->top) / hitIndex->bandHeight;
+      if (band + 1 < hitIndex->bandStart.size()) {
+        // stops if the handler has changed the children
+        for (uint32_t i = hitIndex->bandStart[band + 1]; i > hitIndex->bandStart[band] && !result && hitIndexValid; i--) {
+          auto child = children[hitIndex->items[i - 1]];
+          if (child && child->rect.contains(x, y)) {
+            result = handler(child);
+          }
+        }
+      }
+    }
+  }
+  else {
+    for (size_t i = children.size(); i > 0 && !result; i--) {
+      auto child = children[i - 1];
+      if (child && child->rect.contains(x, y)) {
+        result = handler(child);
+      }
+    }
+  }
+  unlockChildren();
+
+  return result;
+}
+
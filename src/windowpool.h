@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Source:
+ *  https://github.com/opentx/libopenui
+ *
+ * This file is a part of libopenui library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include "window.h"
+
+// Detached windows waiting to be bound again to another item.
+// Windows are keyed by an item type chosen by the caller, a recycled
+// window is only handed back for the same type.
+class WindowPool
+{
+  public:
+    WindowPool() = default;
+
+    WindowPool(const WindowPool &) = delete;
+
+    WindowPool & operator=(const WindowPool &) = delete;
+
+    ~WindowPool()
+    {
+      clear();
+    }
+
+    // returns a detached window of this type, or nullptr if the pool has none
+    Window * acquire(int type)
+    {
+      for (auto & bucket: buckets) {
+        if (bucket.type == type) {
+          if (bucket.windows.empty())
+            return nullptr;
+          auto window = bucket.windows.back();
+          bucket.windows.pop_back();
+          return window;
+        }
+      }
+      return nullptr;
+    }
+
+    template <class T>
+    T * acquire(int type)
+    {
+      return static_cast<T *>(acquire(type));
+    }
+
+    void release(int type, Window * window)
+    {
+      window->detach();
+      for (auto & bucket: buckets) {
+        if (bucket.type == type) {
+          bucket.windows.push_back(window);
+          return;
+        }
+      }
+      buckets.push_back({type, {window}});
+    }
+
+    size_t size() const
+    {
+      size_t result = 0;
+      for (auto & bucket: buckets) {
+        result += bucket.windows.size();
+      }
+      return result;
+    }
+
+    void clear()
+    {
+      for (auto & bucket: buckets) {
+        for (auto window: bucket.windows) {
+          window->deleteLater();
+        }
+      }
+      buckets.clear();
+    }
+
+  protected:
+    struct Bucket {
+      int type;
+      std::vector<Window *> windows;
+    };
+    std::vector<Bucket> buckets;
+};